@@ -0,0 +1,147 @@
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "chip8.hpp"
+#include "fixedRun.hpp"
+#include "timing.hpp"
+#include "lockstep.hpp"
+
+/******************************************************************************
+/
+/  Interpreter throughput benchmark
+/
+/  Usage: ./chip8bench [-v] [-i=instances | -l=lanes] [-n=cycles] <rom-file>...
+/
+/  Runs each ROM headlessly for the given number of cycles (default 
+/  DEFAULT_CYCLES), ticking the timers every CYCLES_PER_TICK cycles, and 
+/  reports emulated cycles per second. With -v the VIP timing model runs 
+/  whole frames instead, until at least that many instructions have run, 
+/  and the report adds emulated VIP machine cycles per second (3668 per 
+/  frame, idle and DMA time included) and the speed relative to a real VIP.
+/  With -i the cycles are spread over that many instances packed 
+/  contiguously in one array, stepped round-robin SLICE_CYCLES at a time, 
+/  to measure instance density and cache behaviour.
+/  With -l they are spread over that many lanes of the lockstep engine, 
+/  each seeded differently, and the share of lane-instructions that ran 
+/  vectorised is reported.
+/  The ROMs in bench/ are also the training set for the profile-guided build
+/  (make pgo).
+/
+******************************************************************************/
+
+#define DEFAULT_CYCLES 50000000L
+#define SLICE_CYCLES 66                     // about one frame at 700 Hz
+
+static void runInstances(char *game, long cycles, long count) {
+    std::vector<Chip8> arena(count, Chip8(false, false, false, game));
+    for(long i = 0; i < count; ++i)
+        arena[i].seed(RNG_SEED + i);
+
+    auto startTime = std::chrono::steady_clock::now();
+    long executed = 0;
+    for(; executed < cycles; executed += count * SLICE_CYCLES) {
+        for(Chip8 &processor : arena) {
+            for(int cycle = 1; cycle <= SLICE_CYCLES; ++cycle) {
+                processor.decode(processor.fetch());
+                if(cycle % CYCLES_PER_TICK == 0)
+                    processor.tickTimers();
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    printf("%-24s %ld instances of %zu bytes (%.0f per GiB): "
+            "%.2f Mcycles/s\n", game, count, sizeof(Chip8), 
+            (double)(1L << 30) / sizeof(Chip8), executed / elapsed.count() / 1e6);
+}
+
+static void runLanes(char *game, long cycles, long count) {
+    lockstep engine(Chip8(false, false, false, game), count);
+    for(long i = 0; i < count; ++i)
+        engine.seed(i, RNG_SEED + i);
+
+    long perLane = (cycles + count - 1) / count;
+    auto startTime = std::chrono::steady_clock::now();
+    engine.run(perLane, CYCLES_PER_TICK);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+    long executed = perLane * count;
+    printf("%-24s %ld lockstep lanes: %.2f Mcycles/s, %.1f%% vectorised\n", 
+            game, count, executed / elapsed.count() / 1e6, 
+            100 * engine.vectorShare());
+}
+
+int main(int argc, char *argv[]) {
+    long cycles = DEFAULT_CYCLES;
+    bool vipTimed = false;
+    long instances = 0, lanes = 0;
+    int first = 1;
+    for(; first < argc && argv[first][0] == '-'; ++first) {
+        if(strncmp(argv[first], "-n=", 3) == 0)
+            cycles = atol(argv[first]+3);
+        else if(strcmp(argv[first], "-v") == 0)
+            vipTimed = true;
+        else if(strncmp(argv[first], "-i=", 3) == 0)
+            instances = atol(argv[first]+3);
+        else if(strncmp(argv[first], "-l=", 3) == 0)
+            lanes = atol(argv[first]+3);
+        else
+            cycles = 0;
+    }
+
+    if(first >= argc || cycles <= 0 || instances < 0 || lanes < 0) {
+        std::cout << "Usage: ./chip8bench [-v] [-i=instances | -l=lanes] [-n=cycles] <rom-file>...\n";
+        return 1;
+    }
+
+    for(int i = first; i < argc; ++i) {
+        if(instances > 0) {
+            runInstances(argv[i], cycles, instances);
+            continue;
+        }
+
+        if(lanes > 0) {
+            runLanes(argv[i], cycles, lanes);
+            continue;
+        }
+
+        Chip8 processor(false, false, false, argv[i]);
+        processor.seed(RNG_SEED);
+
+        if(vipTimed) {
+            vipTiming timing(&processor);
+            long frames = 0;
+
+            auto startTime = std::chrono::steady_clock::now();
+            for(; timing.executed() < (uint64_t)cycles; ++frames) {
+                timing.runFrame();
+                processor.tickTimers();
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+            printf("%-24s %llu instructions in %.3f s: %.2f Minstr/s, "
+                    "%.2f VIP Mcycles/s, %.0fx VIP speed\n", argv[i], 
+                    (unsigned long long)timing.executed(), elapsed.count(), 
+                    timing.executed() / elapsed.count() / 1e6,
+                    timing.cycles() / elapsed.count() / 1e6,
+                    frames / 60.0 / elapsed.count());
+            continue;
+        }
+
+        auto startTime = std::chrono::steady_clock::now();
+        for(long cycle = 1; cycle <= cycles; ++cycle) {
+            processor.decode(processor.fetch());
+            if(cycle % CYCLES_PER_TICK == 0)
+                processor.tickTimers();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+        printf("%-24s %ld cycles in %.3f s: %.2f Mcycles/s (hash %016llx)\n", 
+                argv[i], cycles, elapsed.count(), cycles / elapsed.count() / 1e6,
+                (unsigned long long)processor.hash());
+    }
+    return 0;
+}
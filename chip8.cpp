@@ -1,41 +1,69 @@
 #include "chip8.hpp"
+#include "decode.hpp"
+#include <type_traits>
+#include <cstddef>
 #include <chrono>
 #include <iostream>
 #include <stdio.h>
 #include <ctime>
 
-/******************************************************************************
-/
-/  instruction formats : IXYN or IXNN or INNN
-/  where I : opcode         (first nibble)
-/        X : second nibble  (denotes first register)
-/        Y : third nibble   (denotes second register)
-/        N : fourth nibble 
-/       NN : second byte
-/      NNN : last 3 nibbles 
-/
-******************************************************************************/
-
-#define   I(instr)((instr & 0xF000) >> 12)
-#define   X(instr)((instr & 0x0F00) >> 8)   
-#define   Y(instr)((instr & 0x00F0) >> 4)   
-#define   N(instr)(instr & 0x000F)        
-#define  NN(instr)(instr & 0x00FF)        
-#define NNN(instr)(instr & 0x0FFF)   
-
-#define MAX_GAME_SIZE (0x1000 - 0x200)
-#define MEM_SIZE 0x1000
-
 #define V variableRegisters
 #define PC programCounter
 
-Chip8::Chip8(bool setAndShift, bool jumpOffsetVariable, bool loadAndStoreIdxInc, char *game) {
+// font sprites for hex digits 0-F, stored at 0x50
+
+static const uint8_t fonts[80] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+static_assert(std::is_trivially_copyable<Chip8>::value, 
+                "Chip8 must stay allocation-free to be packed in arrays");
+static_assert(sizeof(Chip8) == 64 + 64 + 256 + MEM_SIZE, 
+                "Chip8 must be one line of hot state, one of stack, then "
+                "display and memory");
+
+// Chip8 mixes access levels, so offsetof is only conditionally supported; 
+// gcc and clang handle it for a class without virtual bases
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+static_assert(offsetof(Chip8, soundTimer) < 64, 
+                "Chip8 hot state must fit the first cache line");
+static_assert(offsetof(Chip8, display) == 128, 
+                "Chip8 display must start after the stack line");
+#pragma GCC diagnostic pop
+
+Chip8::Chip8(bool setAndShift, bool jumpOffsetVariable, bool loadAndStoreIdxInc) {
 
     this->setAndShift = setAndShift;
     this->jumpOffsetVariable = jumpOffsetVariable;
     this->loadAndStoreIdxInc = loadAndStoreIdxInc;
 
-    // load game instrunctions into memory
+    // start with an empty program, which loops at 0x200
+
+    loadGame(NULL, 0);
+    seed(time(0));
+}
+
+Chip8::Chip8(bool setAndShift, bool jumpOffsetVariable, bool loadAndStoreIdxInc, char *game) 
+        : Chip8(setAndShift, jumpOffsetVariable, loadAndStoreIdxInc) {
+
+    // read game instrunctions from file
 
     FILE *fgame;
     fgame = fopen(game, "rb");
@@ -45,49 +73,101 @@ Chip8::Chip8(bool setAndShift, bool jumpOffsetVariable, bool loadAndStoreIdxInc,
         exit(42);
     }
     
-    fread(&memory[0x200], 1, MAX_GAME_SIZE, fgame);
-    fseek(fgame, 0L, SEEK_END);
+    uint8_t gameData[MAX_GAME_SIZE];
+    long gameSize = fread(gameData, 1, MAX_GAME_SIZE, fgame);
+    fclose(fgame);
+
+    loadGame(gameData, gameSize);
+}
+
+void Chip8::seed(uint32_t value) {
+    rngState = value != 0 ? value : 0x1;    // xorshift never leaves 0
+}
+
+void Chip8::loadGame(const uint8_t *game, long gameSize) {
+
+    // reset machine state, keeping the ambiguous instruction config
+
+    for (int i = 0; i < MEM_SIZE; ++i)
+        memory[i] = 0x0;
+    for (int i = 0; i < 16; ++i)
+        V[i] = 0x0;
+    indexRegister = 0x0;
+    clearScreen();
+    stackPointer = 0;
+    keyWaitState = 0;
+    keys = 0x0;
+    delayTimer = soundTimer = 0;
+
+    // load game instrunctions into memory
+
+    if (gameSize > MAX_GAME_SIZE)
+        gameSize = MAX_GAME_SIZE;
+    for (long i = 0; i < gameSize; ++i)
+        memory[0x200 + i] = game[i];
 
     // add one more instruction at end to loop back to beginning of program
 
-    long gameSize =  ftell(fgame);
     memory[(0x200 + gameSize) % MEM_SIZE] = 0x12;
     memory[(0x200 + gameSize + 1) % MEM_SIZE] = 0x00;
-    fclose(fgame);
-
 
     // load fonts into memory
 
-    uint8_t fonts[80] = {
-        0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-        0x20, 0x60, 0x20, 0x20, 0x70, // 1
-        0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-        0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-        0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-        0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-        0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-        0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-        0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-        0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-        0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-        0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-        0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-        0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-        0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-        0xF0, 0x80, 0xF0, 0x80, 0x80  // F
-    };
-
     for (int i = 0; i < 80; ++i)
         memory[0x50 + i] = fonts[i];
 
     PC = 0x200;
 }
 
+bool Chip8::tickTimers() {
+
+    // called at 60 Hz; returns true while the sound timer is active
+
+    if(delayTimer > 0)
+        delayTimer--;
+
+    if(soundTimer > 0) {
+        soundTimer--;
+        return true;
+    }
+    return false;
+}
+
+uint64_t Chip8::hash() const {
+
+    // 64-bit FNV-1a over the packed screen, V0-VF, I, PC and the timers
+
+    uint8_t state[256 + 16 + 6];
+    packDisplay(state);
+    for (int i = 0; i < 16; ++i)
+        state[256 + i] = V[i];
+    state[272] = indexRegister >> 8, state[273] = indexRegister & 0xFF;
+    state[274] = PC >> 8, state[275] = PC & 0xFF;
+    state[276] = delayTimer, state[277] = soundTimer;
+
+    uint64_t h = 0xCBF29CE484222325;
+    for (uint8_t byte : state)
+        h = (h ^ byte) * 0x100000001B3;
+    return h;
+}
+
+void Chip8::packDisplay(uint8_t packed[256]) const {
+
+    // one bit per pixel, row-major, leftmost pixel in the MSB
+
+    for(int i = 0; i < 256; ++i)
+        packed[i] = display[i / 8] >> (56 - 8 * (i % 8));
+}
+
 uint16_t Chip8::fetch() {
-    uint16_t curInstruction = memory[PC];
+
+    // addresses wrap at MEM_SIZE here and in FX33/FX55/FX65: memory is the 
+    // last member, so an unmasked index would reach the next packed Chip8
+
+    uint16_t curInstruction = memory[PC % MEM_SIZE];
     PC++;
     curInstruction <<= 8;
-    curInstruction |= memory[PC];
+    curInstruction |= memory[PC % MEM_SIZE];
     PC++;
     return curInstruction;
 }
@@ -268,15 +348,39 @@ bool Chip8::decode(uint16_t instr) {
     return refreshDisplay;
 }
 
+bool Chip8::isValid(uint16_t instr) {
+
+    // false for the instructions decode() rejects
+
+    switch(I(instr)) {
+        case 0x0:
+            return NNN(instr) == 0x0E0 || NNN(instr) == 0x0EE;
+
+        case 0x8:
+            return N(instr) <= 0x7 || N(instr) == 0xE;
+
+        case 0xF:
+            switch(NN(instr)) {
+                case 0x07: case 0x15: case 0x18: case 0x1E: case 0x0A:
+                case 0x29: case 0x33: case 0x55: case 0x65:
+                    return true;
+            }
+            return false;
+
+        default:
+            return true;
+    }
+}
+
 void Chip8::clearScreen() {
     for(int i = 0; i < 32; ++i)
-        for(int j = 0; j < 64; ++j)
-            display[i][j] = false;
+        display[i] = 0;
 }
 
 void Chip8::_return() {
-    PC = Stack.top();
-    Stack.pop();
+    // the stack wraps at 16 entries rather than over- or underflowing
+    stackPointer--;
+    PC = Stack[stackPointer & 0xF];
 }
 
 void Chip8::jump(uint16_t memLoc) {
@@ -284,7 +388,8 @@ void Chip8::jump(uint16_t memLoc) {
 }
 
 void Chip8::subroutine(uint16_t memLoc) {
-    Stack.push(PC);
+    Stack[stackPointer & 0xF] = PC;
+    stackPointer++;
     PC = memLoc; 
 }
 
@@ -387,38 +492,47 @@ void Chip8::jumpWithOffset(uint16_t memLoc) {
 }
 
 void Chip8::random(uint8_t regLoc, uint8_t value) {
-    srand(time(0));
-    V[regLoc] = value & (rand() % 256);
+    V[regLoc] = value & nextRandom();
+}
+
+uint8_t Chip8::nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState >> 24;
 }
 
 void Chip8::draw(uint8_t regLoc1, uint8_t regLoc2, uint8_t spriteHeight) {
-    uint8_t xCoord = V[regLoc1] % 64, yCoord = V[regLoc2] % 32;
-    V[0xF] = 0;
+    V[0xF] = blit(V[regLoc1], V[regLoc2], spriteHeight, indexRegister);
+} 
+
+uint8_t Chip8::blit(uint8_t x, uint8_t y, uint8_t spriteHeight, uint16_t index) {
+    uint8_t xCoord = x % 64, yCoord = y % 32;
+    uint8_t collision = 0;
     for(int spriteRow = 0; spriteRow < spriteHeight; ++spriteRow) {
         int Y = yCoord + spriteRow;
         if(Y >= 32)
             break;
-        uint8_t spriteRowData = memory[indexRegister + spriteRow];
-        for(int spriteBit = 0; spriteBit < 8; ++spriteBit) {
-            int X = xCoord + spriteBit;
-            if(X >= 64)
-                break;
-            bool spritePixel = (spriteRowData & (1 << (7 - spriteBit))) != 0;
-            if(spritePixel && display[Y][X])
-                display[Y][X] = false, V[0xF] = 1;
-            else if(spritePixel && !display[Y][X])
-                display[Y][X] = true;
-        }
+
+        // line the sprite row up with pixel xCoord; bits shifted past 
+        // pixel 63 are clipped
+        uint64_t spriteRowData = (uint64_t)memory[(index + spriteRow) % MEM_SIZE] << 56;
+        spriteRowData >>= xCoord;
+
+        if(display[Y] & spriteRowData)
+            collision = 1;
+        display[Y] ^= spriteRowData;
     }
-} 
+    return collision;
+}
 
 void Chip8::skipIfKey(uint8_t regLoc) {
-    if(keys[V[regLoc]])
+    if(keys & (1 << N(V[regLoc])))
         PC += 2;
 }
 
 void Chip8::skipIfNotKey(uint8_t regLoc) {
-    if(!keys[V[regLoc]])
+    if(!(keys & (1 << N(V[regLoc]))))
         PC += 2;
 }
 
@@ -443,24 +557,17 @@ void Chip8::addToIndex(uint8_t regLoc) {
 }
 
 void Chip8::getKey(uint8_t regLoc) {
-    static uint8_t state = 0, key;
-
-    if(state == 0) {
-        bool keyPressed = false;
-        for(key = 0x0; key <= 0xF; ++key) {
-            if(keys[key]) {
-                keyPressed = true;
-                break;
-            }
+    if(keyWaitState == 0) {
+        if(keys != 0x0) {
+            for(keyWaitKey = 0x0; !(keys & (1 << keyWaitKey)); ++keyWaitKey);
+            keyWaitState = 1;
         }
-        if(keyPressed)
-            state = 1;
         PC -= 2;
     }
     
-    else if(state == 1 && !keys[key]) {
-        state = 0;
-        V[regLoc] = key; 
+    else if(keyWaitState == 1 && !(keys & (1 << keyWaitKey))) {
+        keyWaitState = 0;
+        V[regLoc] = keyWaitKey; 
     }
     
     else
@@ -474,14 +581,14 @@ void Chip8::fontCharacter(uint8_t regLoc) {
 void Chip8::BCDconvert(uint8_t regLoc) {
     uint8_t temp = V[regLoc];
     for(int i = 2; i >= 0; i--) {
-        memory[indexRegister + i] = temp % 10;
+        memory[(indexRegister + i) % MEM_SIZE] = temp % 10;
         temp /= 10;
     }
 }
 
 void Chip8::store(uint8_t memLoc) {
     for(uint8_t i = 0x0; i <= memLoc; ++i)
-        memory[indexRegister + i] = V[i];
+        memory[(indexRegister + i) % MEM_SIZE] = V[i];
 
     if(loadAndStoreIdxInc)
         indexRegister += memLoc + 1;
@@ -489,7 +596,7 @@ void Chip8::store(uint8_t memLoc) {
 
 void Chip8::load(uint8_t memLoc) {
     for(uint8_t i = 0x0; i <= memLoc; ++i)
-        V[i] = memory[indexRegister + i];
+        V[i] = memory[(indexRegister + i) % MEM_SIZE];
 
     if(loadAndStoreIdxInc)
         indexRegister += memLoc + 1;
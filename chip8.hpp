@@ -1,15 +1,34 @@
 #pragma once
 
 #include <cstdint>
-#include <stack>
 
-class Chip8 {
+/******************************************************************************
+/
+/  Machine state is laid out for packing many instances together: the 
+/  registers, timers and keypad touched on every cycle share the first cache
+/  line, followed by a line for the call stack, the packed display and 
+/  memory. Nothing is heap allocated, so a Chip8 is trivially copyable and 
+/  arrays of them (e.g. std::vector<Chip8>) sit contiguously, 64-byte 
+/  aligned.
+/
+******************************************************************************/
 
-    uint8_t memory[4096];
+class alignas(64) Chip8 {
+
+    friend class debugger;
+    friend class remoteControl;
+    friend class vipTiming;
+    friend class lockstep;
+
+    // hot state, first cache line
+
+    uint8_t variableRegisters[16];
     uint16_t programCounter;
     uint16_t indexRegister;
-    std::stack<uint16_t> Stack;
-    uint8_t variableRegisters[16];
+    uint32_t rngState;                      // xorshift32 state for CXNN
+    uint8_t stackPointer;                   // number of entries in Stack
+    uint8_t keyWaitState;                   // FX0A: 1 once a key is down
+    uint8_t keyWaitKey;                     // FX0A: the key being waited on
 
     // instructions
 
@@ -48,7 +67,14 @@ class Chip8 {
     void store(uint8_t);                    // FX55
     void load(uint8_t);                     // FX65
 
-    // ambiguous instruction config
+    // CXNN and DXYN without the V registers, shared with lockstep
+
+    uint8_t nextRandom();                   // next random byte
+    uint8_t blit(uint8_t, uint8_t, uint8_t, uint16_t);
+                                            // draws sprite at I to (X, Y), 
+                                            // returns the new VF
+
+    // ambiguous instruction config, also in the first cache line
 
     bool setAndShift;                       // if true, set value of VX to VY 
                                             // before shift operations 8XY6 and 
@@ -69,14 +95,37 @@ class Chip8 {
                                             // remains unchanged
 
 public:
-    
-    Chip8(bool, bool, bool, char *game);
-    bool display[32][64];
-    bool keys[16];
+
+    uint16_t keys;                          // keypad state, bit K is set 
+                                            // while hex key K is held down
     uint8_t delayTimer;
     uint8_t soundTimer;
+
+private:
+
+    alignas(64) uint16_t Stack[16];
+
+public:
+
+    alignas(64) uint64_t display[32];       // one row per word, pixel X in 
+                                            // bit 63 - X
+
+private:
+
+    alignas(64) uint8_t memory[4096];
+
+public:
+
+    Chip8(bool = false, bool = false, bool = false);
+    Chip8(bool, bool, bool, char *game);
+    void loadGame(const uint8_t*, long);
     uint16_t fetch();
     bool decode(uint16_t);
+    static bool isValid(uint16_t);
+    bool tickTimers();
+    void packDisplay(uint8_t[256]) const;
+    void seed(uint32_t);
+    uint64_t hash() const;
 
 };
 
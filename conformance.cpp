@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chip8.hpp"
+#include "fixedRun.hpp"
+#include "lockstep.hpp"
+
+/******************************************************************************
+/
+/  Golden-image conformance runner
+/
+/  Usage: ./chip8conformance [--record] [--lanes=n] <manifest>
+/
+/  Each non-empty manifest line that does not start with # names a case:
+/
+/       <rom-file> <quirks> <cycles> <hash> [<keys>]
+/
+/  where quirks is any combination of s, j and l (as on the emulator command
+/  line) or - for none. Every case runs headlessly from a fixed RNG seed for
+/  the given number of cycles, ticking the timers every CYCLES_PER_TICK
+/  cycles, and the final Chip8::hash() of screen, registers and timers is
+/  compared to the 16 hex digit golden hash. With --record the manifest is
+/  printed back with the hashes filled in, for checking in new golden values
+/  (a new case with keys needs a placeholder hash, e.g. 0).
+/
+/  The optional keys field scripts the keypad as comma-separated 
+/  <tick>:<bitmask> pairs, a decimal count of timer ticks and the hex keypad
+/  state from then on: 10:0020,20:0 presses key 5 after 10 ticks and 
+/  releases it after 20. Without it no key is ever down.
+/
+/  With --lanes=n each case runs as n lanes of the lockstep engine instead,
+/  lane l seeded with RNG_SEED + l and additionally holding down key l % 16
+/  (lane 0 none, so it follows the script alone). A case then also fails 
+/  unless every lane's hash equals that of a Chip8 run on its own with the
+/  same seed and keys.
+/
+/  Cases run in parallel on all hardware threads. Exits with 1 if any case
+/  fails.
+/
+******************************************************************************/
+
+struct keyChange {
+    long tick;                              // timer ticks before the change
+    uint16_t keys;                          // keypad bitmask from then on
+};
+
+struct testCase {
+    std::string rom;
+    std::string quirks;
+    long cycles;
+    uint64_t expected;
+    std::string script;                     // keys field as written
+    std::vector<keyChange> keys;            // parsed, in tick order
+    uint64_t actual;
+    bool lanesMatch;                        // lanes agree with separate runs
+};
+
+static bool parseKeys(const std::string &script, std::vector<keyChange> &keys) {
+    std::istringstream changes(script);
+    std::string change;
+    while(std::getline(changes, change, ',')) {
+        char *end;
+        long tick = strtol(change.c_str(), &end, 10);
+        if(*end != ':' || tick < 0 || (!keys.empty() && tick <= keys.back().tick))
+            return false;
+        unsigned long mask = strtoul(end + 1, &end, 16);
+        if(*end != '\0' || mask > 0xFFFF)
+            return false;
+        keys.push_back({ tick, (uint16_t)mask });
+    }
+    return !keys.empty();
+}
+
+static void runAlone(Chip8 &processor, const testCase &test, uint16_t held) {
+    processor.keys = held;
+    size_t next = 0;
+    for(long cycle = 1; cycle <= test.cycles; ++cycle) {
+        if(next < test.keys.size() 
+                && test.keys[next].tick * CYCLES_PER_TICK == cycle - 1)
+            processor.keys = test.keys[next++].keys | held;
+        processor.decode(processor.fetch());
+        if(cycle % CYCLES_PER_TICK == 0)
+            processor.tickTimers();
+    }
+}
+
+static uint16_t laneKeys(long lane) {
+    return lane == 0 ? 0x0 : 1 << (lane % 16);
+}
+
+static void run(testCase &test, long lanes) {
+    bool setAndShift = test.quirks.find('s') != std::string::npos;
+    bool jumpOffsetVariable = test.quirks.find('j') != std::string::npos;
+    bool loadStoreIdxInc = test.quirks.find('l') != std::string::npos;
+
+    Chip8 processor(setAndShift, jumpOffsetVariable, loadStoreIdxInc, 
+                        (char*)test.rom.c_str());
+    processor.seed(RNG_SEED);
+    test.lanesMatch = true;
+
+    if(lanes == 0) {
+        runAlone(processor, test, 0x0);
+        test.actual = processor.hash();
+        return;
+    }
+
+    // key changes fall on tick boundaries, so running up to each of them 
+    // keeps the engine's timer ticks where runAlone has them
+
+    lockstep engine(processor, lanes);
+    for(long l = 0; l < lanes; ++l) {
+        engine.seed(l, RNG_SEED + l);
+        engine.setKeys(l, laneKeys(l));
+    }
+    long done = 0;
+    for(const keyChange &change : test.keys) {
+        long at = std::min(test.cycles, change.tick * CYCLES_PER_TICK);
+        engine.run(at - done, CYCLES_PER_TICK);
+        done = at;
+        for(long l = 0; l < lanes; ++l)
+            engine.setKeys(l, change.keys | laneKeys(l));
+    }
+    engine.run(test.cycles - done, CYCLES_PER_TICK);
+
+    for(long l = 0; l < lanes; ++l) {
+        Chip8 reference = processor;
+        reference.seed(RNG_SEED + l);
+        runAlone(reference, test, laneKeys(l));
+
+        uint64_t hash = engine.lane(l).hash();
+        test.lanesMatch &= hash == reference.hash();
+        if(l == 0)
+            test.actual = hash;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool record = false;
+    long lanes = 0;
+    int first = 1;
+    for(; first < argc - 1; ++first) {
+        if(strcmp(argv[first], "--record") == 0)
+            record = true;
+        else if(strncmp(argv[first], "--lanes=", 8) == 0)
+            lanes = atol(argv[first]+8);
+        else
+            break;
+    }
+
+    if(first != argc - 1 || lanes < 0) {
+        std::cout << "Usage: ./chip8conformance [--record] [--lanes=n] <manifest>\n";
+        return 1;
+    }
+
+    std::ifstream manifest(argv[argc-1]);
+    if(!manifest) {
+        fprintf(stderr, "Unable to open manifest: %s\n", argv[argc-1]);
+        return 42;
+    }
+
+    std::vector<testCase> tests;
+    std::string line;
+    while(std::getline(manifest, line)) {
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        testCase test = { "", "", 0, 0, "", {}, 0, true };
+        fields >> test.rom >> test.quirks >> test.cycles >> std::hex >> test.expected
+                >> test.script;
+        if(test.rom.empty() || test.cycles <= 0 
+                || (!test.script.empty() && !parseKeys(test.script, test.keys))) {
+            fprintf(stderr, "Malformed manifest line: %s\n", line.c_str());
+            return 42;
+        }
+        tests.push_back(test);
+    }
+
+    // run cases on a pool of workers pulling from a shared index
+
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            for(size_t t = next++; t < tests.size(); t = next++)
+                run(tests[t], lanes);
+        });
+    }
+    for(std::thread &worker : workers)
+        worker.join();
+
+    int failures = 0;
+    for(const testCase &test : tests) {
+        if(record) {
+            printf("%s %s %ld %016llx%s%s\n", test.rom.c_str(), 
+                    test.quirks.c_str(), test.cycles, (unsigned long long)test.actual,
+                    test.script.empty() ? "" : " ", test.script.c_str());
+            continue;
+        }
+        bool pass = test.actual == test.expected && test.lanesMatch;
+        failures += !pass;
+        printf("%s  %s %s (%016llx)%s\n", pass ? "PASS" : "FAIL", test.rom.c_str(), 
+                test.quirks.c_str(), (unsigned long long)test.actual, 
+                test.lanesMatch ? "" : " lanes differ from separate runs");
+    }
+
+    if(!record)
+        printf("%zu cases, %d failed\n", tests.size(), failures);
+    return failures != 0;
+}
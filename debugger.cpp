@@ -0,0 +1,229 @@
+#include "debugger.hpp"
+#include "decode.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdio.h>
+
+/******************************************************************************
+/
+/  Terminal debugger
+/
+/  The front-end only routes cycles through step() while the debugger is
+/  armed (paused, stepping over a call, or with at least one breakpoint or
+/  watchpoint set); otherwise it keeps calling decode(fetch()) directly, so
+/  an idle debugger costs nothing in the hot loop.
+/
+/  Commands (addresses in hex):
+/
+/       s           step one instruction
+/       n           step over a subroutine call (2NNN)
+/       c           continue until a breakpoint or watchpoint is hit
+/       b ADDR      set breakpoint at ADDR
+/       d ADDR      delete breakpoint at ADDR
+/       w ADDR      watch writes to memory at ADDR
+/       u ADDR      remove watchpoint at ADDR
+/       l           list breakpoints and watchpoints
+/       r           show registers and stack
+/       m ADDR [N]  dump N (default 0x40) bytes of memory from ADDR
+/       h           list these commands
+/       q           quit the emulator
+/
+******************************************************************************/
+
+static const char *help =
+    "s           step one instruction\n"
+    "n           step over a subroutine call (2NNN)\n"
+    "c           continue until a breakpoint or watchpoint is hit\n"
+    "b ADDR      set breakpoint at ADDR\n"
+    "d ADDR      delete breakpoint at ADDR\n"
+    "w ADDR      watch writes to memory at ADDR\n"
+    "u ADDR      remove watchpoint at ADDR\n"
+    "l           list breakpoints and watchpoints\n"
+    "r           show registers and stack\n"
+    "m ADDR [N]  dump N (default 0x40) bytes of memory from ADDR\n"
+    "h           list these commands\n"
+    "q           quit the emulator\n"
+    "(addresses in hex)\n";
+
+debugger::debugger(Chip8 *processor, bool startPaused) {
+    this->processor = processor;
+    paused = startPaused;
+    steppingOver = false;
+    rearm();
+}
+
+void debugger::rearm() {
+    armed = paused || steppingOver || !breakpoints.empty() 
+                || !watchpoints.empty();
+}
+
+void debugger::pause() {
+    paused = true;
+    rearm();
+}
+
+bool debugger::writesWatched(uint16_t instr) {
+
+    // only FX33 and FX55 write to memory, both starting at I
+
+    int first = processor->indexRegister, count;
+    if(I(instr) == 0xF && NN(instr) == 0x33)
+        count = 3;
+    else if(I(instr) == 0xF && NN(instr) == 0x55)
+        count = X(instr) + 1;
+    else
+        return false;
+
+    for(int i = 0; i < count; ++i) {
+        int addr = (first + i) % MEM_SIZE;
+        if(watchpoints.count(addr)) {
+            printf("watchpoint: %04X writes 0x%03X\n", instr, addr);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool debugger::shouldStop(uint16_t instr) {
+    uint16_t pc = processor->programCounter;
+
+    if(paused)
+        return true;
+
+    if(steppingOver && pc == stepOverReturn 
+            && processor->stackPointer == stepOverDepth) {
+        steppingOver = false;
+        return true;
+    }
+
+    if(breakpoints.count(pc)) {
+        printf("breakpoint: 0x%03X\n", pc);
+        return true;
+    }
+
+    return !watchpoints.empty() && writesWatched(instr);
+}
+
+void debugger::printRegisters() {
+    printf("PC=%03X  I=%03X  SP=%u  DT=%02X  ST=%02X  next=%02X%02X\n", 
+            processor->programCounter, processor->indexRegister, 
+            processor->stackPointer, processor->delayTimer, 
+            processor->soundTimer, 
+            processor->memory[processor->programCounter % MEM_SIZE],
+            processor->memory[(processor->programCounter + 1) % MEM_SIZE]);
+
+    for(int i = 0x0; i <= 0xF; ++i)
+        printf("V%X=%02X%c", i, processor->variableRegisters[i], 
+                i % 8 == 7 ? '\n' : ' ');
+
+    printf("stack:");
+    for(int i = processor->stackPointer - 1; i >= 0; --i)
+        printf(" %03X", processor->Stack[i & 0xF]);
+    printf("\n");
+}
+
+void debugger::printMemory(uint16_t addr, uint16_t length) {
+    for(uint16_t i = 0; i < length; ++i) {
+        if(i % 16 == 0)
+            printf("%s%03X:", i ? "\n" : "", (addr + i) % MEM_SIZE);
+        printf(" %02X", processor->memory[(addr + i) % MEM_SIZE]);
+    }
+    printf("\n");
+}
+
+bool debugger::prompt() {
+    printRegisters();
+    
+    std::string line;
+    while(true) {
+        std::cout << "(chip8) " << std::flush;
+        if(!std::getline(std::cin, line))
+            return false;
+
+        std::istringstream args(line);
+        std::string command;
+        unsigned int addr, length = 0x40;
+        args >> command;
+        bool hasAddr = (bool)(args >> std::hex >> addr);
+        args >> std::hex >> length;
+
+        if(command == "" || command == "s") {
+            paused = true;
+            break;
+        }
+
+        else if(command == "n") {
+            uint16_t pc = processor->programCounter;
+            paused = I(processor->memory[pc % MEM_SIZE] << 8) != 0x2;
+            if(!paused) {
+                steppingOver = true;
+                stepOverReturn = pc + 2;
+                stepOverDepth = processor->stackPointer;
+            }
+            break;
+        }
+
+        else if(command == "c") {
+            paused = false;
+            break;
+        }
+
+        else if(command == "q")
+            return false;
+
+        else if(command == "r")
+            printRegisters();
+
+        else if(command == "h")
+            std::cout << help;
+
+        else if(command == "l") {
+            for(uint16_t bp : breakpoints)
+                printf("breakpoint 0x%03X\n", bp);
+            for(uint16_t wp : watchpoints)
+                printf("watchpoint 0x%03X\n", wp);
+        }
+
+        else if(!hasAddr)
+            std::cout << "unknown command or missing address, h for help\n";
+
+        else if(command == "b")
+            breakpoints.insert(addr % MEM_SIZE);
+
+        else if(command == "d")
+            breakpoints.erase(addr % MEM_SIZE);
+
+        else if(command == "w")
+            watchpoints.insert(addr % MEM_SIZE);
+
+        else if(command == "u")
+            watchpoints.erase(addr % MEM_SIZE);
+
+        else if(command == "m")
+            printMemory(addr, length);
+
+        else
+            std::cout << "unknown command or missing address, h for help\n";
+    }
+
+    rearm();
+    return true;
+}
+
+bool debugger::step(bool &quit) {
+
+    // checked counterpart of decode(fetch()); stops for the prompt first if
+    // the next instruction hits a breakpoint or watchpoint
+
+    uint16_t pc = processor->programCounter;
+    uint16_t instr = (processor->memory[pc % MEM_SIZE] << 8) 
+                        | processor->memory[(pc + 1) % MEM_SIZE];
+
+    if(shouldStop(instr) && !prompt()) {
+        quit = true;
+        return false;
+    }
+
+    return processor->decode(processor->fetch());
+}
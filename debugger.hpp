@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include "chip8.hpp"
+
+class debugger {
+
+    Chip8 *processor;
+    std::set<uint16_t> breakpoints;         // PC values to stop at
+    std::set<uint16_t> watchpoints;         // memory addresses to stop on 
+                                            // before they are written
+    bool paused;
+    bool steppingOver;
+    uint16_t stepOverReturn;
+    uint8_t stepOverDepth;
+    bool armed;                             // true while any of the above 
+                                            // needs the checked step()
+
+    void rearm();
+    bool shouldStop(uint16_t);
+    bool writesWatched(uint16_t);
+    bool prompt();
+    void printRegisters();
+    void printMemory(uint16_t, uint16_t);
+
+public:
+
+    debugger(Chip8*, bool);
+    bool isArmed() const { return armed; }
+    void pause();
+    bool step(bool&);
+
+};
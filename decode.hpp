@@ -0,0 +1,26 @@
+#pragma once
+
+/******************************************************************************
+/
+/  instruction formats : IXYN or IXNN or INNN
+/  where I : opcode         (first nibble)
+/        X : second nibble  (denotes first register)
+/        Y : third nibble   (denotes second register)
+/        N : fourth nibble
+/       NN : second byte
+/      NNN : last 3 nibbles
+/
+/  Shared by the interpreter and everything else that decodes instructions
+/  or addresses memory (debugger, remote control, VIP timing, lockstep).
+/
+******************************************************************************/
+
+#define   I(instr)((instr & 0xF000) >> 12)
+#define   X(instr)((instr & 0x0F00) >> 8)
+#define   Y(instr)((instr & 0x00F0) >> 4)
+#define   N(instr)(instr & 0x000F)
+#define  NN(instr)(instr & 0x00FF)
+#define NNN(instr)(instr & 0x0FFF)
+
+#define MEM_SIZE 0x1000
+#define MAX_GAME_SIZE (MEM_SIZE - 0x200)
@@ -0,0 +1,11 @@
+#pragma once
+
+/******************************************************************************
+/
+/  Settings shared by the tools that run ROMs reproducibly without a window
+/  (chip8conformance, chip8bench), so their runs and hashes agree.
+/
+******************************************************************************/
+
+#define CYCLES_PER_TICK 11                  // 700 Hz clock, 60 Hz timers
+#define RNG_SEED 0xC8C8C8C8
@@ -0,0 +1,51 @@
+#include "headless.hpp"
+#include "remote.hpp"
+
+headless::headless(Chip8 *processor, int clockSpeed, videoSink *video, 
+        vipTiming *timing) {
+    this->processor = processor;
+    this->clockSpeed = clockSpeed;
+    this->video = video;
+    this->timing = timing;
+}
+
+void headless::run(long frames) {
+
+    // emulate frames 60 Hz ticks as fast as possible, without a window; 
+    // each frame runs the cycles the clock reaches by its end, so clock 
+    // speeds that are not multiples of 60 (or are below it) keep their rate
+
+    for(long frame = 0; frame < frames; ++frame) {
+        if(timing != NULL)
+            timing->runFrame();
+        else {
+            long cycles = (frame + 1) * clockSpeed / 60 - frame * clockSpeed / 60;
+            for(long cycle = 0; cycle < cycles; ++cycle)
+                processor->decode(processor->fetch());
+        }
+
+        processor->tickTimers();
+
+        if(video != NULL)
+            video->pushFrame(*processor);
+    }
+}
+
+int runHeadless(const options &opts) {
+    Chip8 processor(opts.setAndShift, opts.jumpOffsetVariable, 
+                        opts.loadStoreIdxInc, opts.game);
+
+    if(opts.remoteSocket != NULL) {
+        remoteControl _remoteControl(&processor, opts.remoteSocket);
+        _remoteControl.serve();
+        return 0;
+    }
+
+    videoSink *video = opts.output != NULL ? new videoSink(opts.output) : NULL;
+    vipTiming *timing = opts.vipTimed ? new vipTiming(&processor) : NULL;
+    headless _headless(&processor, opts.clockSpeed, video, timing);
+    _headless.run(opts.headlessFrames);
+    delete timing;
+    delete video;
+    return 0;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "chip8.hpp"
+#include "video.hpp"
+#include "options.hpp"
+#include "timing.hpp"
+
+class headless {
+
+    Chip8 *processor;
+    int clockSpeed;
+    videoSink *video;
+    vipTiming *timing;                      // NULL when clocked
+
+public:
+
+    headless(Chip8*, int, videoSink*, vipTiming*);
+    void run(long);
+
+};
+
+int runHeadless(const options&);
@@ -0,0 +1,18 @@
+#include "options.hpp"
+#include "headless.hpp"
+
+// windowless runner for machines without SDL; runs 10 seconds of frames 
+// unless --headless or --remote say otherwise
+
+int main(int argc, char *argv[]) {
+    options opts;
+    if(!parseOptions(argc, argv, opts)) {
+        help("./chip8headless");
+        return 1;
+    }
+
+    if(opts.headlessFrames < 0)
+        opts.headlessFrames = 600;
+
+    return runHeadless(opts);
+}
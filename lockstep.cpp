@@ -0,0 +1,778 @@
+#include "lockstep.hpp"
+#include "decode.hpp"
+#include <algorithm>
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/******************************************************************************
+/
+/  Lockstep multi-instance interpreter
+/
+/  Runs many copies of one machine (same ROM and quirks, differing in keys
+/  and RNG seeds). V0-VF, PC and I live in a structure-of-arrays register 
+/  file. step(n) gives every lane a budget of n instructions and repeatedly
+/  issues one instruction to all lanes with budget left that sit at the 
+/  lowest PC among them, so lanes that fell behind after a skip or branch 
+/  catch up and reconverge. Lanes are independent, so as long as each runs
+/  exactly n instructions between calls the result matches running them 
+/  one by one. run() does the same for many steps with timer ticks between
+/  them.
+/
+/  An issue decodes its instruction once and applies it to the issuing 
+/  lanes straight on the register file: 6XNN, 7XNN and 8XYN 32 lanes per 
+/  AVX2 operation (masked when not every lane takes part, and with a 
+/  portable loop when AVX2 is unavailable), jumps, skips, ANNN, FX1E and 
+/  FX29 in one pass, and the instructions on per-lane state (stack, timers,
+/  keys, display, memory, RNG) in a loop over the lanes' Chip8s. Only FX0A
+/  and invalid instructions go through the scalar interpreter.
+/
+/  When fewer than 1/DIVERGED_RATIO of the lanes would issue together, the 
+/  lanes are scattered: their Chip8s take over V, PC and I and run on their
+/  own, like separate instances, until lockstep is retried RETRY_STEPS 
+/  steps later (backing off to MAX_RETRY_STEPS while retries keep failing)
+/  or their PCs line up.
+/
+/  Instructions are only compared across lanes inside the memory range 
+/  FX33/FX55 have written to, the only place lanes can hold different code.
+/
+******************************************************************************/
+
+// loop over the lanes in lanesMask, or all of them if it is NULL
+
+#define FOR_LANES(l) for(size_t l = 0; l < lanes; ++l) \
+                        if(lanesMask == NULL || lanesMask[l])
+
+#define LANE_BLOCK 32                       // lanes per AVX2 register
+#define DIVERGED_RATIO 8                    // below 1/8 issuing, run alone
+#define RETRY_STEPS 16L                     // steps between lockstep retries,
+#define MAX_RETRY_STEPS 256L                // doubling while they keep failing
+
+/******************************************************************************
+/
+/  6XNN, 7XNN and 8XYN over n lanes of register rows, limited to the lanes
+/  set in mask unless it is NULL; the load/store order of each case follows
+/  the scalar instruction, so X, Y and VF aliasing behave the same.
+/
+******************************************************************************/
+
+static void aluRows(uint16_t instr, uint8_t *vx, uint8_t *vy, uint8_t *vf, 
+        const uint8_t *mask, size_t n, bool setAndShift) {
+
+    for(size_t l = 0; l < n; ++l) {
+        if(mask != NULL && !mask[l])
+            continue;
+        switch(I(instr) == 0x8 ? N(instr) : I(instr) << 4) {
+            case 0x60: vx[l] = NN(instr); break;
+            case 0x70: vx[l] += NN(instr); break;
+            case 0x0: vx[l] = vy[l]; break;
+            case 0x1: vx[l] |= vy[l]; break;
+            case 0x2: vx[l] &= vy[l]; break;
+            case 0x3: vx[l] ^= vy[l]; break;
+            case 0x4:
+                vx[l] += vy[l];
+                vf[l] = vx[l] < vy[l];
+                break;
+            case 0x5:
+                vf[l] = vx[l] > vy[l];
+                vx[l] -= vy[l];
+                break;
+            case 0x6:
+                if(setAndShift)
+                    vx[l] = vy[l];
+                vx[l] >>= 1;
+                break;
+            case 0x7:
+                vf[l] = vy[l] > vx[l];
+                vx[l] = vy[l] - vx[l];
+                break;
+            case 0xE:
+                if(setAndShift)
+                    vx[l] = vy[l];
+                vx[l] <<= 1;
+                break;
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void aluRowsAVX2(uint16_t instr, uint8_t *vx, uint8_t *vy, uint8_t *vf, 
+        const uint8_t *mask, size_t n, bool setAndShift) {
+
+    const __m256i one = _mm256_set1_epi8(1), ones = _mm256_set1_epi8(-1);
+    const __m256i immediate = _mm256_set1_epi8(NN(instr));
+
+#define LOAD(p) _mm256_loadu_si256((const __m256i*)(p + l))
+#define STORE(p, v) _mm256_storeu_si256((__m256i*)(p + l), mask == NULL ? (v) \
+                        : _mm256_blendv_epi8(LOAD(p), v, LOAD(mask)))
+#define GREATER(a, b) _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b), ones)
+
+    for(size_t l = 0; l < n; l += LANE_BLOCK) {
+        switch(I(instr) == 0x8 ? N(instr) : I(instr) << 4) {
+            case 0x60: STORE(vx, immediate); break;
+            case 0x70: STORE(vx, _mm256_add_epi8(LOAD(vx), immediate)); break;
+            case 0x0: STORE(vx, LOAD(vy)); break;
+            case 0x1: STORE(vx, _mm256_or_si256(LOAD(vx), LOAD(vy))); break;
+            case 0x2: STORE(vx, _mm256_and_si256(LOAD(vx), LOAD(vy))); break;
+            case 0x3: STORE(vx, _mm256_xor_si256(LOAD(vx), LOAD(vy))); break;
+            case 0x4:
+                STORE(vx, _mm256_add_epi8(LOAD(vx), LOAD(vy)));
+                STORE(vf, _mm256_and_si256(GREATER(LOAD(vy), LOAD(vx)), one));
+                break;
+            case 0x5:
+                STORE(vf, _mm256_and_si256(GREATER(LOAD(vx), LOAD(vy)), one));
+                STORE(vx, _mm256_sub_epi8(LOAD(vx), LOAD(vy)));
+                break;
+            case 0x6:
+                if(setAndShift)
+                    STORE(vx, LOAD(vy));
+                STORE(vx, _mm256_and_si256(_mm256_srli_epi16(LOAD(vx), 1), 
+                                            _mm256_set1_epi8(0x7F)));
+                break;
+            case 0x7:
+                STORE(vf, _mm256_and_si256(GREATER(LOAD(vy), LOAD(vx)), one));
+                STORE(vx, _mm256_sub_epi8(LOAD(vy), LOAD(vx)));
+                break;
+            case 0xE:
+                if(setAndShift)
+                    STORE(vx, LOAD(vy));
+                STORE(vx, _mm256_and_si256(_mm256_slli_epi16(LOAD(vx), 1), 
+                                            _mm256_set1_epi8((char)0xFE)));
+                break;
+        }
+    }
+
+#undef LOAD
+#undef STORE
+#undef GREATER
+}
+
+static uint16_t registersUsed(uint16_t instr) {
+
+    // bitmask of the V registers a scalar instruction reads or writes
+
+    uint16_t vx = 1 << X(instr), vy = 1 << Y(instr);
+    switch(I(instr)) {
+        case 0xB:
+            return 0x1 | vx;                                    // BNNN
+        case 0xC:
+        case 0xE:
+            return vx;                                          // CXNN, EX9E, EXA1
+        case 0xD:
+            return vx | vy | 0x8000;                            // DXYN
+        case 0xF:
+            if(NN(instr) == 0x55 || NN(instr) == 0x65)
+                return (vx << 1) - 1;                           // FX55, FX65
+            return vx | (NN(instr) == 0x1E ? 0x8000 : 0x0);     // FX1E sets VF
+        default:
+            return 0x0;                                         // 00E0, 00EE, 2NNN
+    }
+}
+
+lockstep::lockstep(const Chip8 &prototype, size_t lanes) {
+    if(lanes == 0) {
+        fprintf(stderr, "A lockstep engine needs at least one lane\n");
+        exit(42);
+    }
+
+    this->lanes = lanes;
+    stride = (lanes + LANE_BLOCK - 1) / LANE_BLOCK * LANE_BLOCK;
+    machines.assign(lanes, prototype);
+
+    registers.resize(16 * stride);
+    programCounters.resize(stride);
+    indexRegisters.resize(stride);
+    remaining.resize(stride);
+    mask.resize(stride);
+    taken.resize(stride);
+    for(size_t l = 0; l < lanes; ++l) {
+        for(int r = 0; r < 16; ++r)
+            registers[r * stride + l] = prototype.variableRegisters[r];
+        indexRegisters[l] = prototype.indexRegister;
+    }
+
+    uniform = true;
+    uniformPC = prototype.programCounter;
+    scattered = false;
+    retried = false;
+    retrySteps = RETRY_STEPS;
+    divergentLow = MEM_SIZE;
+    divergentHigh = 0;
+    setAndShift = prototype.setAndShift;
+    jumpOffsetVariable = prototype.jumpOffsetVariable;
+    loadAndStoreIdxInc = prototype.loadAndStoreIdxInc;
+    useAVX2 = __builtin_cpu_supports("avx2");
+    vectorSteps = scalarSteps = 0;
+}
+
+const Chip8 &lockstep::lane(size_t l) {
+
+    // write the lane's registers back so its Chip8 is complete
+
+    Chip8 &machine = machines[l];
+    if(scattered)
+        return machine;
+    for(int r = 0; r < 16; ++r)
+        machine.variableRegisters[r] = registers[r * stride + l];
+    machine.programCounter = uniform ? uniformPC : programCounters[l];
+    machine.indexRegister = indexRegisters[l];
+    return machine;
+}
+
+void lockstep::setKeys(size_t l, uint16_t keys) {
+    machines[l].keys = keys;
+}
+
+void lockstep::seed(size_t l, uint32_t value) {
+    machines[l].seed(value);
+}
+
+void lockstep::run(long cycles, long cyclesPerTick) {
+
+    // step() cycles instructions in chunks of cyclesPerTick, ticking the 
+    // timers after each full chunk. Scattered lanes run retrySteps chunks
+    // at a time on their own, timers included, before lockstep is retried.
+
+    for(long done = 0; done < cycles; ) {
+        if(scattered) {
+            long span = std::min(cycles - done, retrySteps * cyclesPerTick);
+            for(Chip8 &machine : machines) {
+                for(long cycle = 1; cycle <= span; ++cycle) {
+                    uint16_t instr = machine.fetch();
+                    noteWrites(instr, machine.indexRegister);
+                    machine.decode(instr);
+                    if(cycle % cyclesPerTick == 0)
+                        machine.tickTimers();
+                }
+            }
+            scalarSteps += span * lanes;
+            done += span;
+            collect();
+            continue;
+        }
+
+        long chunk = std::min(cycles - done, cyclesPerTick);
+        step(chunk);
+        if(chunk == cyclesPerTick)
+            tickTimers();
+        done += chunk;
+    }
+}
+
+void lockstep::tickTimers() {
+    for(Chip8 &machine : machines)
+        machine.tickTimers();
+}
+
+double lockstep::vectorShare() const {
+    uint64_t total = vectorSteps + scalarSteps;
+    return total ? (double)vectorSteps / total : 0.0;
+}
+
+void lockstep::noteWrites(uint16_t instr, uint16_t index) {
+
+    // widen the divergent range by what an FX33 or FX55 is about to write
+
+    int first = index % MEM_SIZE, last;
+    if(I(instr) == 0xF && NN(instr) == 0x33)
+        last = first + 2;
+    else if(I(instr) == 0xF && NN(instr) == 0x55)
+        last = first + X(instr);
+    else
+        return;
+
+    if(last >= MEM_SIZE)                    // wraps around to 0x000
+        divergentLow = 0, divergentHigh = MEM_SIZE - 1;
+    else {
+        divergentLow = std::min<int>(divergentLow, first);
+        divergentHigh = std::max<int>(divergentHigh, last);
+    }
+}
+
+uint16_t lockstep::instructionAt(size_t l, uint16_t pc) {
+    const uint8_t *memory = machines[l].memory;
+    uint16_t at = pc % MEM_SIZE;
+    return (memory[at] << 8) | memory[(at + 1) % MEM_SIZE];
+}
+
+bool lockstep::sameCode(uint16_t pc) {
+
+    // both bytes, the second of which wraps to 0x000 for an instruction at 
+    // 0xFFF, must lie outside the divergent range
+
+    int at = pc % MEM_SIZE, next = (at + 1) % MEM_SIZE;
+    return (at < divergentLow || at > divergentHigh)
+            && (next < divergentLow || next > divergentHigh);
+}
+
+void lockstep::spread() {
+
+    // leave converged mode, giving every lane its own PC again
+
+    for(size_t l = 0; l < lanes; ++l)
+        programCounters[l] = uniformPC;
+    uniform = false;
+}
+
+void lockstep::rejoin() {
+
+    // return to converged mode if every lane ended up at the same PC
+
+    uint16_t pc = programCounters[0];
+    bool samePC = true;
+    for(size_t l = 1; l < lanes; ++l)
+        samePC &= programCounters[l] == pc;
+    if(samePC) {
+        uniform = true;
+        uniformPC = pc;
+    }
+}
+
+size_t lockstep::gather(uint16_t &instr) {
+
+    // mark the lanes with budget left at the lowest PC among them, which 
+    // also see the same instruction there; returns how many were marked
+
+    uint16_t pc = 0;
+    size_t leader = lanes;
+    for(size_t l = 0; l < lanes; ++l) {
+        if(remaining[l] > 0 && (leader == lanes || programCounters[l] < pc))
+            pc = programCounters[l], leader = l;
+    }
+    if(leader == lanes)
+        return 0;
+
+    instr = instructionAt(leader, pc);
+    bool checkCode = !sameCode(pc);
+
+    size_t count = 0;
+    for(size_t l = 0; l < lanes; ++l) {
+        bool issue = remaining[l] > 0 && programCounters[l] == pc;
+        if(issue && checkCode)
+            issue = instructionAt(l, pc) == instr;
+        mask[l] = issue ? 0xFF : 0x00;
+        count += issue;
+    }
+    return count;
+}
+
+void lockstep::advance(const uint8_t *lanesMask) {
+
+    // move the lanes in lanesMask (every lane if NULL) to the next 
+    // instruction
+
+    if(uniform)
+        uniformPC += 2;
+    else
+        for(size_t l = 0; l < lanes; ++l)
+            programCounters[l] += lanesMask == NULL ? 2 : lanesMask[l] & 2;
+}
+
+void lockstep::jumpTo(uint16_t target, const uint8_t *lanesMask) {
+    if(uniform)
+        uniformPC = target;
+    else
+        FOR_LANES(l)
+            programCounters[l] = target;
+}
+
+void lockstep::skip(const uint8_t *lanesMask) {
+
+    // move the lanes in lanesMask past the next instruction where taken is
+    // set, and just to it elsewhere; converged lanes that all agree stay so
+
+    if(uniform) {
+        uint8_t any = 0, all = 1;
+        for(size_t l = 0; l < lanes; ++l)
+            any |= taken[l], all &= taken[l];
+        if(any == all) {
+            uniformPC += 2 + 2 * all;
+            return;
+        }
+        spread();
+    }
+
+    FOR_LANES(l)
+        programCounters[l] += 2 + 2 * taken[l];
+}
+
+bool lockstep::execute(uint16_t instr, const uint8_t *lanesMask, size_t count) {
+
+    // run instr on the count lanes in lanesMask (every lane if NULL) 
+    // straight on the register file; false for what is left to stepLanes
+
+    uint8_t *vx = &registers[X(instr) * stride];
+    uint8_t *vy = &registers[Y(instr) * stride];
+    uint8_t *vf = &registers[0xF * stride];
+    uint16_t *index = indexRegisters.data();
+    bool vectorised = true;
+
+    switch(I(instr)) {
+        case 0x0:
+            if(NNN(instr) == 0x0E0) {
+                FOR_LANES(l)
+                    machines[l].clearScreen();
+                advance(lanesMask);
+            }
+            else if(NNN(instr) == 0x0EE) {
+                if(uniform)
+                    spread();
+                FOR_LANES(l) {
+                    Chip8 &machine = machines[l];
+                    machine.stackPointer--;
+                    programCounters[l] = machine.Stack[machine.stackPointer & 0xF];
+                }
+            }
+            else
+                return false;
+            vectorised = false;
+            break;
+
+        case 0x1:
+            jumpTo(NNN(instr), lanesMask);
+            break;
+
+        case 0x2:
+            FOR_LANES(l) {
+                Chip8 &machine = machines[l];
+                machine.Stack[machine.stackPointer & 0xF] = 
+                        (uniform ? uniformPC : programCounters[l]) + 2;
+                machine.stackPointer++;
+            }
+            jumpTo(NNN(instr), lanesMask);
+            vectorised = false;
+            break;
+
+        case 0x3:
+        case 0x4:
+            for(size_t l = 0; l < lanes; ++l)
+                taken[l] = (vx[l] == NN(instr)) == (I(instr) == 0x3);
+            skip(lanesMask);
+            break;
+
+        case 0x5:
+        case 0x9:
+            for(size_t l = 0; l < lanes; ++l)
+                taken[l] = (vx[l] == vy[l]) == (I(instr) == 0x5);
+            skip(lanesMask);
+            break;
+
+        case 0x8:
+            if(N(instr) > 0x7 && N(instr) != 0xE)
+                return false;
+            // fall through
+
+        case 0x6:
+        case 0x7:
+            if(useAVX2)
+                aluRowsAVX2(instr, vx, vy, vf, lanesMask, stride, setAndShift);
+            else
+                aluRows(instr, vx, vy, vf, lanesMask, lanes, setAndShift);
+            advance(lanesMask);
+            break;
+
+        case 0xA:
+            FOR_LANES(l)
+                index[l] = NNN(instr);
+            advance(lanesMask);
+            break;
+
+        case 0xB:
+            if(uniform)
+                spread();
+            FOR_LANES(l)
+                programCounters[l] = NNN(instr) 
+                        + registers[(jumpOffsetVariable ? X(instr) : 0x0) * stride + l];
+            vectorised = false;
+            break;
+
+        case 0xC:
+            FOR_LANES(l)
+                vx[l] = NN(instr) & machines[l].nextRandom();
+            advance(lanesMask);
+            vectorised = false;
+            break;
+
+        case 0xD:
+            FOR_LANES(l)
+                vf[l] = machines[l].blit(vx[l], vy[l], N(instr), index[l]);
+            advance(lanesMask);
+            vectorised = false;
+            break;
+
+        case 0xE:
+            if(NN(instr) == 0x9E || NN(instr) == 0xA1) {
+                for(size_t l = 0; l < lanes; ++l)
+                    taken[l] = ((machines[l].keys >> N(vx[l])) & 1) == (NN(instr) == 0x9E);
+                skip(lanesMask);
+            }
+            else
+                advance(lanesMask);
+            vectorised = false;
+            break;
+
+        case 0xF:
+            switch(NN(instr)) {
+                case 0x07:
+                    FOR_LANES(l)
+                        vx[l] = machines[l].delayTimer;
+                    vectorised = false;
+                    break;
+
+                case 0x15:
+                    FOR_LANES(l)
+                        machines[l].delayTimer = vx[l];
+                    vectorised = false;
+                    break;
+
+                case 0x18:
+                    FOR_LANES(l)
+                        machines[l].soundTimer = vx[l];
+                    vectorised = false;
+                    break;
+
+                case 0x1E:
+                    FOR_LANES(l) {
+                        index[l] += vx[l];
+                        if(index[l] < vx[l])
+                            vf[l] = 0x1;
+                    }
+                    break;
+
+                case 0x29:
+                    FOR_LANES(l)
+                        index[l] = 0x50 + 5 * N(vx[l]);
+                    break;
+
+                case 0x33:
+                    FOR_LANES(l) {
+                        noteWrites(instr, index[l]);
+                        uint8_t *memory = machines[l].memory;
+                        memory[index[l] % MEM_SIZE] = vx[l] / 100;
+                        memory[(index[l] + 1) % MEM_SIZE] = vx[l] / 10 % 10;
+                        memory[(index[l] + 2) % MEM_SIZE] = vx[l] % 10;
+                    }
+                    vectorised = false;
+                    break;
+
+                case 0x55:
+                case 0x65:
+                    FOR_LANES(l) {
+                        uint8_t *memory = machines[l].memory;
+                        if(NN(instr) == 0x55) {
+                            noteWrites(instr, index[l]);
+                            for(int r = 0; r <= X(instr); ++r)
+                                memory[(index[l] + r) % MEM_SIZE] = registers[r * stride + l];
+                        }
+                        else
+                            for(int r = 0; r <= X(instr); ++r)
+                                registers[r * stride + l] = memory[(index[l] + r) % MEM_SIZE];
+                        if(loadAndStoreIdxInc)
+                            index[l] += X(instr) + 1;
+                    }
+                    vectorised = false;
+                    break;
+
+                default:
+                    return false;                               // FX0A
+            }
+            advance(lanesMask);
+            break;
+
+        default:
+            return false;
+    }
+
+    if(vectorised)
+        vectorSteps += count;
+    else
+        scalarSteps += count;
+    return true;
+}
+
+void lockstep::stepUniform(uint16_t instr) {
+
+    // converged path: every lane runs instr from uniformPC; they stay 
+    // converged unless it is a branch the lanes disagree on
+
+    if(!execute(instr, NULL, lanes)) {
+        spread();
+        stepLanes(instr, NULL);
+        scalarSteps += lanes;
+    }
+
+    if(!uniform)
+        rejoin();
+}
+
+void lockstep::stepLanes(uint16_t instr, const uint8_t *lanesMask) {
+
+    // run instr through the scalar interpreter on every lane in lanesMask
+    // (all lanes if NULL). Only the registers it uses are moved out of and
+    // back into the register file, a row at a time.
+
+    uint16_t used = registersUsed(instr);
+
+    for(uint16_t bits = used; bits != 0; bits &= bits - 1) {
+        const uint8_t *row = &registers[__builtin_ctz(bits) * stride];
+        FOR_LANES(l)
+            machines[l].variableRegisters[__builtin_ctz(bits)] = row[l];
+    }
+
+    FOR_LANES(l) {
+        Chip8 &machine = machines[l];
+        machine.programCounter = programCounters[l];
+        machine.indexRegister = indexRegisters[l];
+        noteWrites(instr, machine.indexRegister);
+
+        machine.decode(machine.fetch());
+
+        programCounters[l] = machine.programCounter;
+        indexRegisters[l] = machine.indexRegister;
+    }
+
+    for(uint16_t bits = used; bits != 0; bits &= bits - 1) {
+        uint8_t *row = &registers[__builtin_ctz(bits) * stride];
+        FOR_LANES(l)
+            row[l] = machines[l].variableRegisters[__builtin_ctz(bits)];
+    }
+}
+
+void lockstep::scatter() {
+
+    // hand V, PC and I back to the lanes' Chip8s, to run them on their own
+
+    for(size_t l = 0; l < lanes; ++l) {
+        Chip8 &machine = machines[l];
+        for(int r = 0; r < 16; ++r)
+            machine.variableRegisters[r] = registers[r * stride + l];
+        machine.programCounter = uniform ? uniformPC : programCounters[l];
+        machine.indexRegister = indexRegisters[l];
+    }
+    uniform = false;
+    scattered = true;
+    scatteredSteps = 0;
+
+    // a retry that scatters again straight away backs off
+
+    if(retried)
+        retrySteps = std::min(2 * retrySteps, MAX_RETRY_STEPS);
+    retried = false;
+}
+
+void lockstep::collect() {
+
+    // take V, PC and I back into the register file after scatter()
+
+    for(size_t l = 0; l < lanes; ++l) {
+        const Chip8 &machine = machines[l];
+        for(int r = 0; r < 16; ++r)
+            registers[r * stride + l] = machine.variableRegisters[r];
+        programCounters[l] = machine.programCounter;
+        indexRegisters[l] = machine.indexRegister;
+    }
+    scattered = false;
+    retried = true;
+    rejoin();
+}
+
+bool lockstep::runAlone() {
+
+    // run every scattered lane through its remaining budget; true if they
+    // all end at the same PC
+
+    bool samePC = true;
+    for(size_t l = 0; l < lanes; ++l) {
+        Chip8 &machine = machines[l];
+        for(long cycle = 0; cycle < remaining[l]; ++cycle) {
+            uint16_t instr = machine.fetch();
+            noteWrites(instr, machine.indexRegister);
+            machine.decode(instr);
+        }
+        scalarSteps += std::max(remaining[l], 0L);
+        remaining[l] = 0;
+        samePC &= machine.programCounter == machines[0].programCounter;
+    }
+    return samePC;
+}
+
+void lockstep::issue(uint16_t instr, size_t count) {
+
+    // run instr on the count lanes marked in mask
+
+    const uint8_t *lanesMask = count == lanes ? NULL : mask.data();
+    if(execute(instr, lanesMask, count))
+        return;
+
+    stepLanes(instr, lanesMask);
+    scalarSteps += count;
+}
+
+void lockstep::step(long cycles) {
+
+    // scattered lanes run on their own, and retry lockstep every 
+    // retrySteps steps or as soon as they line up again
+
+    if(scattered) {
+        for(size_t l = 0; l < lanes; ++l)
+            remaining[l] = cycles;
+        if(runAlone() || ++scatteredSteps == retrySteps)
+            collect();
+        return;
+    }
+
+    stepTogether(cycles);
+
+    // a retry that held together ends the back-off
+
+    if(retried && !scattered) {
+        retried = false;
+        retrySteps = RETRY_STEPS;
+    }
+}
+
+void lockstep::stepTogether(long cycles) {
+    long left = cycles;
+
+    // while converged, every lane is at uniformPC with the same budget, so 
+    // no per-lane bookkeeping is needed
+
+    for(; uniform && left > 0; --left) {
+        uint16_t instr = instructionAt(0, uniformPC);
+        if(!sameCode(uniformPC)) {
+            bool same = true;
+            for(size_t l = 1; l < lanes; ++l)
+                same &= instructionAt(l, uniformPC) == instr;
+            if(!same) {
+                spread();
+                break;
+            }
+        }
+
+        stepUniform(instr);
+    }
+
+    if(uniform || left <= 0)
+        return;
+
+    for(size_t l = 0; l < lanes; ++l)
+        remaining[l] = left;
+
+    uint16_t instr;
+    for(size_t count; (count = gather(instr)) > 0; ) {
+
+        // once too few lanes issue together to pay for the bookkeeping, 
+        // let every lane use up its budget on its own
+        if(count * DIVERGED_RATIO < lanes) {
+            scatter();
+            if(runAlone())
+                collect();
+            return;
+        }
+
+        issue(instr, count);
+        for(size_t l = 0; l < lanes; ++l)
+            remaining[l] -= mask[l] & 1;
+    }
+    rejoin();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "chip8.hpp"
+
+class lockstep {
+
+    std::vector<Chip8> machines;            // memory, display, stack, timers
+                                            // and keys of every lane
+    size_t lanes;
+    size_t stride;                          // lanes rounded up to LANE_BLOCK
+
+    // structure-of-arrays register file, authoritative over the copies 
+    // held in machines unless scattered
+
+    std::vector<uint8_t> registers;         // V[r] of lane l at r*stride + l
+    std::vector<uint16_t> programCounters;
+    std::vector<uint16_t> indexRegisters;
+    std::vector<long> remaining;            // instructions left this step()
+    std::vector<uint8_t> mask;              // 0xFF for lanes in this issue
+
+    bool uniform;                           // all lanes at uniformPC, whose 
+    uint16_t uniformPC;                     // programCounters are then stale
+
+    bool scattered;                         // machines hold V, PC and I, the
+    long scatteredSteps;                    // register file is stale
+    long retrySteps;                        // scattered steps between tries
+    bool retried;                           // collected, not yet held together
+
+    uint16_t divergentLow;                  // memory range that may differ
+    uint16_t divergentHigh;                 // between lanes after writes
+
+    std::vector<uint8_t> taken;             // per-lane outcome of a skip
+
+    bool setAndShift;
+    bool jumpOffsetVariable;
+    bool loadAndStoreIdxInc;
+    bool useAVX2;
+
+    uint64_t vectorSteps;                   // lane-instructions run as vector
+                                            // or single-pass operations
+    uint64_t scalarSteps;                   // lane-instructions run lane by 
+                                            // lane
+
+    uint16_t instructionAt(size_t, uint16_t);
+    bool sameCode(uint16_t);
+    void noteWrites(uint16_t, uint16_t);
+    void spread();
+    void rejoin();
+    size_t gather(uint16_t&);
+    void advance(const uint8_t*);
+    void jumpTo(uint16_t, const uint8_t*);
+    void skip(const uint8_t*);
+    bool execute(uint16_t, const uint8_t*, size_t);
+    void stepUniform(uint16_t);
+    void stepLanes(uint16_t, const uint8_t*);
+    void scatter();
+    void collect();
+    bool runAlone();
+    void issue(uint16_t, size_t);
+    void stepTogether(long);
+
+public:
+
+    lockstep(const Chip8&, size_t);
+    size_t size() const { return lanes; }
+    const Chip8 &lane(size_t);
+    void setKeys(size_t, uint16_t);
+    void seed(size_t, uint32_t);
+    void step(long);
+    void run(long, long);
+    void tickTimers();
+    double vectorShare() const;
+
+};
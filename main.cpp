@@ -0,0 +1,36 @@
+#include <SDL2/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include "options.hpp"
+#include "headless.hpp"
+#include "sdlDraw.hpp"
+
+int main(int argc, char *argv[]) {
+    options opts;
+    if(!parseOptions(argc, argv, opts)) {
+        help("./chip8emu");
+        return 1;
+    }
+
+    if(opts.remoteSocket != NULL || opts.headlessFrames >= 0)
+        return runHeadless(opts);
+
+    // the window's bell and debugger prompt write to stdout, so a video 
+    // stream can only go there without a window
+
+    if(opts.output != NULL && strcmp(opts.output, "-") == 0) {
+        fprintf(stderr, "--output=- requires --headless\n");
+        return 42;
+    }
+
+    videoSink *video = opts.output != NULL ? new videoSink(opts.output) : NULL;
+
+    sdlDraw _sdlDraw(opts.game, opts.setAndShift, opts.jumpOffsetVariable, 
+                        opts.loadStoreIdxInc, opts.clockSpeed, opts.pixelSize, 
+                        opts.fgColor, opts.bgColor, opts.keyMap, opts.debug, video,
+                        opts.vipTimed);
+    
+    _sdlDraw.display();
+    delete video;
+    return 0;
+}
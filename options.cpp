@@ -0,0 +1,153 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include "options.hpp"
+
+void help(const char *program) {
+    std::cout << "Usage: " << program << " [OPTIONS] <game-file>\n";
+    std::cout << "Chip 8 Emulator\n";
+    std::cout << "Example: " << program << " -sjl game_rom.ch8\n\n";
+    std::cout << "Options:\n\n";
+    std::cout << "\t-h\t--help\t\t\tDisplays this help text\n";
+    std::cout << "\t-p=n\t--pixel-size=n\t\tSets pixel size to n\n";
+    std::cout << "\t-c=n\t--clock-speed=n\t\tSets clock speed to n\n";
+    std::cout << "\t-fg=n\t--foreground=n\t\tSets foreground to n (RRGGBB hex)\n";
+    std::cout << "\t-bg=n\t--background=n\t\tSets background to n (RRGGBB hex)\n";
+    std::cout << "\t-r=f\t--remote=f\t\tRuns without a window, controlled over Unix socket f\n";
+    std::cout << "\t-o=f\t--output=f\t\tRecords 60 fps video to f (.y4m, or PNG prefix)\n";
+    std::cout << "\t\t\t\t\t(- streams Y4M to stdout, with --headless only)\n";
+    std::cout << "\t-f=n\t--headless=n\t\tRuns n frames without a window\n";
+    std::cout << "\t-v\t--vip-timing\t\tRuns at COSMAC VIP speed using per-opcode cycle costs\n";
+    std::cout << "\t\t\t\t\t(ignores clock speed; clocked while debugging)\n";
+    std::cout << "\t-d\t--debug\t\t\tStarts paused in the terminal debugger (F12 breaks in)\n";
+    std::cout << "\t-k=m\t--key-map=m\t\tBinds hex keys 0-F to the 16 keys in m\n";
+    std::cout << "\t\t\t\t\t(default: " DEFAULT_KEY_MAP ", sampled at 240 Hz)\n\n";
+    std::cout << "Following options enable configuration of ambiguous instructions\n\n";
+    std::cout << "\t-s\t--set-and-shift\t\t\tSet value of VX to VY before shift operations 8XY6 and 8XYE\n";
+    std::cout << "\t-j\t--jump-offset-variable\t\tJump with offset instruction";
+    std::cout << "BNNN jumps to the address XNN, plus the value in the register VX\n";
+    std::cout << "\t-l\t--load-store-idx-inc\t\tSet index register (I) value to";
+    std::cout << "I + X + 1 after executing load (FX65) or store (FX55) instructions\n\n";
+}
+
+bool parseOptions(int argc, char *argv[], options &opts) {
+    opts.setAndShift = opts.jumpOffsetVariable = opts.loadStoreIdxInc = 0;
+    opts.debug = opts.vipTimed = 0;
+    opts.pixelSize = 8, opts.clockSpeed = 700;
+    opts.fgColor = 0xFFFFFFFF, opts.bgColor = 0xFF000000;
+    opts.keyMap = DEFAULT_KEY_MAP, opts.remoteSocket = NULL, opts.output = NULL;
+    opts.headlessFrames = -1;
+
+    if(argc < 2 || strcmp(argv[argc-1], "--help") == 0 
+            || strcmp(argv[argc-1], "-h") == 0)
+        return false;
+    opts.game = argv[argc-1];
+
+    // process commandline args
+    for(int i = 1; i < argc-1; ++i) {
+        if(strncmp(argv[i], "--foreground=", 13) == 0)
+            opts.fgColor = std::stoi(std::string(argv[i]+13), 0, 16);
+        
+        else if(strncmp(argv[i], "--background=", 13) == 0)
+            opts.bgColor = std::stoi(std::string(argv[i]+13), 0, 16);
+
+        else if(strncmp(argv[i], "-bg=", 4) == 0)
+            opts.bgColor = std::stoi(std::string(argv[i]+4), 0, 16);
+
+        else if(strncmp(argv[i], "-fg=", 4) == 0)
+            opts.fgColor = std::stoi(std::string(argv[i]+4), 0, 16);
+
+        else if(strncmp(argv[i], "--pixel-size=", 13) == 0) 
+            opts.pixelSize = atoi(argv[i]+13);
+
+        else if(strncmp(argv[i], "-p=", 3) == 0) 
+            opts.pixelSize = atoi(argv[i]+3);
+        
+        else if(strncmp(argv[i], "--key-map=", 10) == 0)
+            opts.keyMap = argv[i]+10;
+
+        else if(strncmp(argv[i], "-k=", 3) == 0)
+            opts.keyMap = argv[i]+3;
+
+        else if(strncmp(argv[i], "--remote=", 9) == 0)
+            opts.remoteSocket = argv[i]+9;
+
+        else if(strncmp(argv[i], "-r=", 3) == 0)
+            opts.remoteSocket = argv[i]+3;
+
+        else if(strncmp(argv[i], "--output=", 9) == 0)
+            opts.output = argv[i]+9;
+
+        else if(strncmp(argv[i], "-o=", 3) == 0)
+            opts.output = argv[i]+3;
+
+        else if(strncmp(argv[i], "--headless=", 11) == 0)
+            opts.headlessFrames = atol(argv[i]+11);
+
+        else if(strncmp(argv[i], "-f=", 3) == 0)
+            opts.headlessFrames = atol(argv[i]+3);
+
+        else if(strncmp(argv[i], "--clock-speed=", 14) == 0)
+            opts.clockSpeed = atoi(argv[i]+14);
+        
+        else if(strncmp(argv[i], "-c=", 3) == 0)
+            opts.clockSpeed = atoi(argv[i]+3);
+
+        else if(strcmp(argv[i], "--set-and-shift") == 0)
+            opts.setAndShift = 1;
+
+        else if(strcmp(argv[i], "--jump-offset-variable") == 0)
+            opts.jumpOffsetVariable = 1;
+        
+        else if(strcmp(argv[i], "--load-store-idx-inc") == 0)
+            opts.loadStoreIdxInc = 1;
+
+        else if(strcmp(argv[i], "--debug") == 0)
+            opts.debug = 1;
+
+        else if(strcmp(argv[i], "--vip-timing") == 0)
+            opts.vipTimed = 1;
+        
+        else if(strncmp(argv[i], "-", 1) == 0) {
+            bool noOptions = 1;
+            for(int j = 1; argv[i][j] != '\0'; ++j) {
+                switch(argv[i][j]) {
+                    case 's':
+                        opts.setAndShift = 1;
+                        noOptions = 0;
+                        break;
+                    
+                    case 'j':
+                        opts.jumpOffsetVariable = 1;
+                        noOptions = 0;
+                        break;
+                    
+                    case 'l':
+                        opts.loadStoreIdxInc = 1;
+                        noOptions = 0;
+                        break;
+
+                    case 'd':
+                        opts.debug = 1;
+                        noOptions = 0;
+                        break;
+
+                    case 'v':
+                        opts.vipTimed = 1;
+                        noOptions = 0;
+                        break;
+
+                    default:
+                        return false;
+                }
+            }
+            if(noOptions)
+                return false;
+        }
+
+        else
+            return false;
+    }
+
+    return strlen(opts.keyMap) == 16;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#define DEFAULT_KEY_MAP "x123qweasdzc4rfv"
+
+struct options {
+    bool setAndShift;
+    bool jumpOffsetVariable;
+    bool loadStoreIdxInc;
+    bool debug;
+    bool vipTimed;                          // --vip-timing
+    int pixelSize;
+    int clockSpeed;
+    int fgColor;
+    int bgColor;
+    const char *keyMap;
+    const char *remoteSocket;               // NULL unless --remote
+    const char *output;                     // NULL unless --output
+    long headlessFrames;                    // -1 unless --headless
+    char *game;
+};
+
+void help(const char*);
+bool parseOptions(int, char*[], options&);
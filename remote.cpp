@@ -0,0 +1,238 @@
+#include "remote.hpp"
+#include "decode.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/******************************************************************************
+/
+/  Remote control protocol over a Unix domain socket
+/
+/  Every request is a frame   [u8 command][u16 length][length bytes payload]
+/  and gets one reply frame   [u8 status] [u16 length][length bytes payload]
+/  with all integers little-endian. Requests are executed in order and the
+/  replies to every complete request in a read are sent back in one write,
+/  so a client can batch e.g. KEYS + FRAME into a single round-trip.
+/
+/  command   payload                     reply payload
+/
+/  0x01 LOAD     ROM bytes               -
+/  0x02 STEP     u32 cycles              -
+/  0x03 KEYS     u16 keypad bitmask      -
+/  0x04 SCREEN   -                       256 bytes packed screen
+/  0x05 PEEK     u16 address, u16 count  count bytes of memory
+/  0x06 SAVE     u8 slot                 -
+/  0x07 RESTORE  u8 slot                 -
+/  0x08 FRAME    u32 cycles              256 bytes packed screen, after 
+/                                        stepping and one 60 Hz timer tick
+/  0x09 REGS     -                       V0-VF, u16 I, u16 PC, u8 DT, u8 ST,
+/                                        u8 stack depth
+/
+/  STEP and FRAME stop at an instruction the interpreter does not know and 
+/  reply HALTED, leaving PC on it; LOAD or RESTORE recovers the machine.
+/
+/  The packed screen holds one bit per pixel, row-major, leftmost pixel in
+/  the most significant bit (see Chip8::packDisplay).
+/
+******************************************************************************/
+
+#define CMD_LOAD    0x01
+#define CMD_STEP    0x02
+#define CMD_KEYS    0x03
+#define CMD_SCREEN  0x04
+#define CMD_PEEK    0x05
+#define CMD_SAVE    0x06
+#define CMD_RESTORE 0x07
+#define CMD_FRAME   0x08
+#define CMD_REGS    0x09
+
+#define STATUS_OK           0x00
+#define STATUS_BAD_COMMAND  0x01
+#define STATUS_BAD_PAYLOAD  0x02
+#define STATUS_NO_SNAPSHOT  0x03
+#define STATUS_HALTED       0x04
+
+#define HEADER_SIZE 3
+
+static uint16_t read16(const uint8_t *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read32(const uint8_t *p) {
+    return read16(p) | ((uint32_t)read16(p + 2) << 16);
+}
+
+static void append16(std::string &out, uint16_t value) {
+    out += (char)(value & 0xFF);
+    out += (char)(value >> 8);
+}
+
+remoteControl::remoteControl(Chip8 *processor, const char *socketPath) {
+    this->processor = processor;
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", socketPath);
+        exit(42);
+    }
+    strcpy(address.sun_path, socketPath);
+
+    // only clear away a stale socket, never some other file at that path
+
+    struct stat existing;
+    if(lstat(socketPath, &existing) == 0) {
+        if(!S_ISSOCK(existing.st_mode)) {
+            fprintf(stderr, "Unable to listen on socket: %s\n", socketPath);
+            exit(42);
+        }
+        unlink(socketPath);
+    }
+
+    server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(server < 0 || bind(server, (struct sockaddr*)&address, sizeof(address)) < 0
+            || listen(server, 1) < 0) {
+        fprintf(stderr, "Unable to listen on socket: %s\n", socketPath);
+        exit(42);
+    }
+}
+
+remoteControl::~remoteControl() {
+    close(server);
+}
+
+uint8_t remoteControl::execute(uint8_t command, const uint8_t *payload, 
+        uint16_t length, std::string &reply) {
+
+    switch(command) {
+        case CMD_LOAD:
+            processor->loadGame(payload, length);
+            return STATUS_OK;
+
+        case CMD_STEP:
+        case CMD_FRAME:
+            if(length != 4)
+                return STATUS_BAD_PAYLOAD;
+            for(uint32_t n = read32(payload); n > 0; --n) {
+                uint16_t instr = processor->fetch();
+                if(!Chip8::isValid(instr)) {
+                    processor->programCounter -= 2;
+                    return STATUS_HALTED;
+                }
+                processor->decode(instr);
+            }
+            if(command == CMD_STEP)
+                return STATUS_OK;
+            processor->tickTimers();
+            // fall through
+
+        case CMD_SCREEN: {
+            uint8_t packed[256];
+            processor->packDisplay(packed);
+            reply.append((const char*)packed, sizeof(packed));
+            return STATUS_OK;
+        }
+
+        case CMD_KEYS:
+            if(length != 2)
+                return STATUS_BAD_PAYLOAD;
+            processor->keys = read16(payload);
+            return STATUS_OK;
+
+        case CMD_PEEK: {
+            if(length != 4)
+                return STATUS_BAD_PAYLOAD;
+            uint16_t addr = read16(payload), count = read16(payload + 2);
+            for(uint32_t i = 0; i < count; ++i)
+                reply += (char)processor->memory[(addr + i) % MEM_SIZE];
+            return STATUS_OK;
+        }
+
+        case CMD_SAVE:
+            if(length != 1)
+                return STATUS_BAD_PAYLOAD;
+            snapshots.insert_or_assign(payload[0], *processor);
+            return STATUS_OK;
+
+        case CMD_RESTORE: {
+            if(length != 1)
+                return STATUS_BAD_PAYLOAD;
+            auto snapshot = snapshots.find(payload[0]);
+            if(snapshot == snapshots.end())
+                return STATUS_NO_SNAPSHOT;
+            *processor = snapshot->second;
+            return STATUS_OK;
+        }
+
+        case CMD_REGS:
+            reply.append((const char*)processor->variableRegisters, 16);
+            append16(reply, processor->indexRegister);
+            append16(reply, processor->programCounter);
+            reply += (char)processor->delayTimer;
+            reply += (char)processor->soundTimer;
+            reply += (char)processor->stackPointer;
+            return STATUS_OK;
+
+        default:
+            return STATUS_BAD_COMMAND;
+    }
+}
+
+void remoteControl::session(int client) {
+    std::string pending, replies, payload;
+    char buffer[4096];
+
+    while(true) {
+        ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+        if(received <= 0)
+            return;
+        pending.append(buffer, received);
+
+        // execute every complete request frame received so far
+
+        size_t offset = 0;
+        while(pending.size() - offset >= HEADER_SIZE) {
+            const uint8_t *frame = (const uint8_t*)pending.data() + offset;
+            uint16_t length = read16(frame + 1);
+            if(pending.size() - offset < (size_t)HEADER_SIZE + length)
+                break;
+
+            payload.clear();
+            uint8_t status = execute(frame[0], frame + HEADER_SIZE, length, payload);
+            replies += (char)status;
+            append16(replies, payload.size());
+            replies += payload;
+            offset += HEADER_SIZE + length;
+        }
+        pending.erase(0, offset);
+
+        // send all replies for this batch in one go
+
+        for(size_t sent = 0; sent < replies.size(); ) {
+            ssize_t n = send(client, replies.data() + sent, 
+                                replies.size() - sent, MSG_NOSIGNAL);
+            if(n <= 0)
+                return;
+            sent += n;
+        }
+        replies.clear();
+    }
+}
+
+void remoteControl::serve() {
+
+    // serve one client at a time until the process is killed
+
+    while(true) {
+        int client = accept(server, NULL, NULL);
+        if(client < 0)
+            continue;
+        session(client);
+        close(client);
+    }
+}
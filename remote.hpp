@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include "chip8.hpp"
+
+class remoteControl {
+
+    Chip8 *processor;
+    std::map<uint8_t, Chip8> snapshots;     // machine copies by slot number
+    int server;                             // listening socket
+
+    uint8_t execute(uint8_t, const uint8_t*, uint16_t, std::string&);
+    void session(int);
+
+public:
+
+    remoteControl(Chip8*, const char*);
+    ~remoteControl();
+    void serve();
+
+};
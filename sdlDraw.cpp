@@ -5,6 +5,11 @@
 #include <cstring>
 #include "sdlDraw.hpp"
 #include "chip8.hpp"
+#include "debugger.hpp"
+#include "options.hpp"
+#include "video.hpp"
+
+#define INPUT_RATE 240                      // keypad sampling rate (Hz)
 
 sdlDraw::sdlDraw(char *game, 
         bool setAndShift = false, 
@@ -13,15 +18,31 @@ sdlDraw::sdlDraw(char *game,
         int clockSpeed = 700, 
         int pixelSize = 8,
         int fgColor = 0xFFFFFFFF,
-        int bgColor = 0xFF000000 
+        int bgColor = 0xFF000000,
+        const char *keyMap = DEFAULT_KEY_MAP,
+        bool debug = false,
+        videoSink *video = NULL,
+        bool vipTimed = false
     ) {
 
     this->fgColor = fgColor;
     this->bgColor = bgColor;
     this->pixelSize = pixelSize;
     this->clockSpeed = clockSpeed;
+    this->video = video;
     screenWidth = pixelSize * 64;
     screenHeight = pixelSize * 32;
+
+    // bind hex key i to the key named by the i-th character of keyMap
+
+    for(int i = 0x0; i <= 0xF; ++i) {
+        char keyName[2] = { keyMap[i], '\0' };
+        this->keyMap[i] = SDL_GetScancodeFromName(keyName);
+        if(this->keyMap[i] == SDL_SCANCODE_UNKNOWN) {
+            fprintf(stderr, "Unknown key in key map: %c\n", keyMap[i]);
+            exit(42);
+        }
+    }
     
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -41,10 +62,12 @@ sdlDraw::sdlDraw(char *game,
                     screenHeight);
     
     processor = new Chip8(setAndShift, jumpOffsetVariable, loadStoreIdxInc, game);
+    dbg = new debugger(processor, debug);
+    timing = vipTimed ? new vipTiming(processor) : NULL;
 
 }
 
-void sdlDraw::update(bool pixels[32][64]) {
+void sdlDraw::update(const uint64_t pixels[32]) {
 
     Uint32* screenPixels = NULL;
     int pitch = 0;
@@ -53,7 +76,7 @@ void sdlDraw::update(bool pixels[32][64]) {
     for (int y = 0; y < screenHeight; y++) {
         for (int x = 0; x < screenWidth; x++) {
             int index = y * (pitch / sizeof(Uint32)) + x;
-            if(pixels[y/pixelSize][x/pixelSize] == 1)
+            if((pixels[y/pixelSize] >> (63 - x/pixelSize)) & 1)
                 screenPixels[index] = fgColor; // set pixel to white
             else
                 screenPixels[index] = bgColor; // set pixel to black
@@ -62,81 +85,114 @@ void sdlDraw::update(bool pixels[32][64]) {
     SDL_UnlockTexture(texture);
 }
 
-void sdlDraw::display() {
+void sdlDraw::present() {
+    update(processor->display);
+
+    // Blit the pixel surface onto the window
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
+
+    // Update the screen and wait for the user to close the window
+    SDL_RenderPresent(renderer);
+}
+
+bool sdlDraw::pollInput() {
+
+    // drain every pending event and fold key transitions into the keypad 
+    // bitmask; returns false once the window has been closed
 
     SDL_Event e;
-    std::chrono::time_point<std::chrono::high_resolution_clock> startTime, endTime, timer;
+    while(SDL_PollEvent(&e) != 0) {
+        if(e.type == SDL_QUIT)
+            return false;
+
+        if((e.type != SDL_KEYDOWN && e.type != SDL_KEYUP) || e.key.repeat)
+            continue;
+
+        // F12 breaks into the debugger prompt on the terminal
+        if(e.type == SDL_KEYDOWN && e.key.keysym.scancode == SDL_SCANCODE_F12)
+            dbg->pause();
+
+        for(int i = 0x0; i <= 0xF; ++i) {
+            if(keyMap[i] != e.key.keysym.scancode)
+                continue;
+            if(e.type == SDL_KEYDOWN)
+                processor->keys |= 1 << i;
+            else
+                processor->keys &= ~(1 << i);
+        }
+    }
+    return true;
+}
+
+void sdlDraw::display() {
+
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime, endTime, timer, inputTimer;
     startTime = std::chrono::high_resolution_clock::now();
     timer = startTime;
-
-    // determine state of input keys (whether pressed or not)
-    const uint8_t* state = SDL_GetKeyboardState(nullptr);
+    inputTimer = startTime;
 
     while(true) {
 
-        if( SDL_PollEvent( &e ) != 0 && e.type == SDL_QUIT) 
-            break;
-         
         endTime = std::chrono::high_resolution_clock::now();
         
         std::chrono::duration<int, std::micro> 
             duration = std::chrono::duration_cast<std::chrono::microseconds> (endTime-startTime),
-            timerDuration = std::chrono::duration_cast<std::chrono::microseconds> (endTime-timer);
-
-        if(timerDuration.count() >= (int)(1e6/60)) {
-            if(processor->delayTimer > 0)
-                processor->delayTimer--;
-        
-            if(processor->soundTimer > 0) {
-                std::cout << "\a";
-                processor->soundTimer--;
-            }
-            timer = std::chrono::high_resolution_clock::now();
-        }
-
-
-        // skip iter if clock cycle not encountered
-        if(duration.count() < (int)(1e6/clockSpeed))
-            continue;
+            timerDuration = std::chrono::duration_cast<std::chrono::microseconds> (endTime-timer),
+            inputDuration = std::chrono::duration_cast<std::chrono::microseconds> (endTime-inputTimer);
 
  /******************************************************************************
  *
- *      Keyboard            Original
- *      Input               Hex Input
+ *      Default             Original
+ *      Key Map             Hex Input
  *      
  *      1 2 3 4             1 2 3 C
  *      Q W E R     -->     4 5 6 D
  *      A S D F     -->     7 8 9 E
  *      Z X C V             A 0 B F
  *
+ *      Input is sampled at INPUT_RATE Hz regardless of the clock speed
+ *
 ******************************************************************************/
 
-        SDL_PumpEvents(); // update keyboard state
+        if(inputDuration.count() >= (int)(1e6/INPUT_RATE)) {
+            if(!pollInput())
+                break;
+            inputTimer = endTime;
+        }
 
-        bool tempArray[16] = {
-            state[SDL_SCANCODE_X], state[SDL_SCANCODE_1], state[SDL_SCANCODE_2],
-            state[SDL_SCANCODE_3], state[SDL_SCANCODE_Q], state[SDL_SCANCODE_W], 
-            state[SDL_SCANCODE_E], state[SDL_SCANCODE_A], state[SDL_SCANCODE_S], 
-            state[SDL_SCANCODE_D], state[SDL_SCANCODE_Z], state[SDL_SCANCODE_C],
-            state[SDL_SCANCODE_4], state[SDL_SCANCODE_R], state[SDL_SCANCODE_F],
-            state[SDL_SCANCODE_V]
-        };
-        
-        for(int i = 0x0; i <= 0xF; ++i)
-            processor->keys[i] = tempArray[i];
-        
-        bool refreshDisplay = processor->decode(processor->fetch());
-        
-        if(refreshDisplay) {
-            update(processor->display);
+        // with the VIP timing model a whole frame runs per 60 Hz tick, 
+        // unless the debugger needs to check every instruction
+
+        bool timedFrames = timing != NULL && !dbg->isArmed();
+
+        if(timerDuration.count() >= (int)(1e6/60)) {
+            if(timedFrames && timing->runFrame())
+                present();
+            if(processor->tickTimers())
+                std::cout << "\a";
+            if(video != NULL)
+                video->pushFrame(*processor);
+            timer = std::chrono::high_resolution_clock::now();
+        }
+
+
+        // skip iter if clock cycle not encountered
+        if(timedFrames || duration.count() < (int)(1e6/clockSpeed))
+            continue;
 
-            // Blit the pixel surface onto the window
-            SDL_RenderCopy(renderer, texture, NULL, NULL);
+        // only take the checked path while a debug feature is armed
 
-            // Update the screen and wait for the user to close the window
-            SDL_RenderPresent(renderer);
-           
+        bool refreshDisplay, quit = false;
+        if(dbg->isArmed()) {
+            refreshDisplay = dbg->step(quit);
+            if(quit)
+                break;
         }
+        else
+            refreshDisplay = processor->decode(processor->fetch());
+        
+        if(refreshDisplay)
+            present();
 
         // reset clock cycle 
         startTime = std::chrono::high_resolution_clock::now();
@@ -151,109 +207,3 @@ void sdlDraw::display() {
     SDL_Quit();
  
 }
-
-void help() {
-    std::cout << "Usage: ./chip8emu [OPTIONS] <game-file>\n";
-    std::cout << "Chip 8 Emulator\n";
-    std::cout << "Example: ./chip8emu -sjl game_rom.ch8\n\n";
-    std::cout << "Options:\n\n";
-    std::cout << "\t-h\t--help\t\t\tDisplays this help text\n";
-    std::cout << "\t-p=n\t--pixel-size=n\t\tSets pixel size to n\n";
-    std::cout << "\t-c=n\t--clock-speed=n\t\tSets clock speed to n\n";
-    std::cout << "\t-fg=n\t--foreground=n\t\tSets foreground to n (RRGGBB hex)\n";
-    std::cout << "\t-bg=n\t--background=n\t\tSets background to n (RRGGBB hex)\n\n";
-    std::cout << "Following options enable configuration of ambiguous instructions\n\n";
-    std::cout << "\t-s\t--set-and-shift\t\t\tSet value of VX to VY before shift operations 8XY6 and 8XYE\n";
-    std::cout << "\t-j\t--jump-offset-variable\t\tJump with offset instruction";
-    std::cout << "BNNN jumps to the address XNN, plus the value in the register VX\n";
-    std::cout << "\t-l\t--load-store-idx-inc\t\tSet index register (I) value to";
-    std::cout << "I + X + 1 after executing load (FX65) or store (FX55) instructions\n\n";
-}
-
-
-int main(int argc, char *argv[]) {
-    bool setAndShift = 0, jumpOffsetVariable = 0, loadStoreIdxInc = 0;
-    int pixelSize = 8, clockSpeed = 700, fgColor = 0xFFFFFFFF, bgColor = 0xFF000000;
-    if(argc < 2 || strcmp(argv[argc-1], "--help") == 0 
-            || strcmp(argv[argc-1], "-h") == 0) {
-        help();
-        return 1;
-    }
-
-    // process commandline args
-    for(int i = 1; i < argc-1; ++i) {
-        if(strncmp(argv[i], "--foreground=", 13) == 0)
-            fgColor = std::stoi(std::string(argv[i]+13), 0, 16);
-        
-        else if(strncmp(argv[i], "--background=", 13) == 0)
-            bgColor = std::stoi(std::string(argv[i]+13), 0, 16);
-
-        else if(strncmp(argv[i], "-bg=", 4) == 0)
-            bgColor = std::stoi(std::string(argv[i]+4), 0, 16);
-
-        else if(strncmp(argv[i], "-fg=", 4) == 0)
-            fgColor = std::stoi(std::string(argv[i]+4), 0, 16);
-
-        else if(strncmp(argv[i], "--pixel-size=", 13) == 0) 
-            pixelSize = atoi(argv[i]+13);
-
-        else if(strncmp(argv[i], "-p=", 3) == 0) 
-            pixelSize = atoi(argv[i]+3);
-        
-        else if(strncmp(argv[i], "--clock-speed=", 14) == 0)
-            clockSpeed = atoi(argv[i]+14);
-        
-        else if(strncmp(argv[i], "-c=", 3) == 0)
-            clockSpeed = atoi(argv[i]+3);
-
-        else if(strcmp(argv[i], "--set-and-shift") == 0)
-            setAndShift = 1;
-
-        else if(strcmp(argv[i], "--jump-offset-variable") == 0)
-            jumpOffsetVariable = 1;
-        
-        else if(strcmp(argv[i], "--load-store-idx-inc") == 0)
-            loadStoreIdxInc = 1;
-        
-        else if(strncmp(argv[i], "-", 1) == 0) {
-            bool noOptions = 1;
-            for(int j = 1; argv[i][j] != '\0'; ++j) {
-                switch(argv[i][j]) {
-                    case 's':
-                        setAndShift = 1;
-                        noOptions = 0;
-                        break;
-                    
-                    case 'j':
-                        jumpOffsetVariable = 1;
-                        noOptions = 0;
-                        break;
-                    
-                    case 'l':
-                        loadStoreIdxInc = 1;
-                        noOptions = 0;
-                        break;
-
-                    default:
-                        help();
-                        return 1;
-                }
-            }
-            if(noOptions) {
-                help();
-                return 1;
-            }
-        }
-
-        else {
-            help();
-            return 1;
-        }
-    }
-
-    sdlDraw _sdlDraw(argv[argc-1], setAndShift, jumpOffsetVariable, 
-                        loadStoreIdxInc, clockSpeed, pixelSize, fgColor, bgColor);
-    
-    _sdlDraw.display();
-    return 0;
-}
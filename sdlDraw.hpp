@@ -1,5 +1,8 @@
 #pragma once
 #include "chip8.hpp"
+#include "debugger.hpp"
+#include "video.hpp"
+#include "timing.hpp"
 
 class sdlDraw {
 
@@ -9,16 +12,23 @@ class sdlDraw {
     SDL_Texture* texture;
 
     Chip8 *processor;
+    debugger *dbg;
+    videoSink *video;
+    vipTiming *timing;                      // NULL when clocked
     int clockSpeed;
     int pixelSize;
     int screenWidth;
     int screenHeight;
     int fgColor;
     int bgColor;
+    SDL_Scancode keyMap[16];                // scancode bound to each hex key
+
+    bool pollInput();
+    void present();
 
 public:
-    sdlDraw(char*, bool, bool, bool, int, int, int, int);
-    void update(bool[32][64]);
+    sdlDraw(char*, bool, bool, bool, int, int, int, int, const char*, bool, videoSink*, bool);
+    void update(const uint64_t[32]);
     void display();
 };
 
@@ -0,0 +1,125 @@
+#include "timing.hpp"
+#include "decode.hpp"
+
+/******************************************************************************
+/
+/  COSMAC VIP timing model
+/
+/  The VIP's 1802 runs at 1.7609 MHz with 8 clocks per machine cycle, giving
+/  3668 machine cycles per 60 Hz frame. Display DMA and the interrupt routine
+/  take about 1094 of those, leaving FRAME_BUDGET for the interpreter. Each
+/  instruction is charged the interpreter's fetch/decode overhead plus an
+/  approximate per-opcode cost taken from the VIP interpreter's routines,
+/  including the data-dependent parts: taken skips, sprite height, the 
+/  digit loop of FX33 and the register count of FX55/FX65. DXYN waits for 
+/  the next vertical blank, so it ends the frame and forfeits what is left
+/  of its budget.
+/
+/  Costs are approximate, in machine cycles (about 4.54 us each).
+/
+******************************************************************************/
+
+#define FRAME_CYCLES 3668
+#define INTERRUPT_CYCLES 1094
+#define FRAME_BUDGET (FRAME_CYCLES - INTERRUPT_CYCLES)
+#define FETCH_COST 20
+#define SKIP_COST 4
+
+vipTiming::vipTiming(Chip8 *processor) {
+    this->processor = processor;
+    credit = 0;
+    frames = 0;
+    instructions = 0;
+}
+
+uint64_t vipTiming::cycles() const {
+
+    // VIP time covered so far, including DMA, interrupts and the rest of a 
+    // frame left idle after DXYN, not just what instructions were charged
+
+    return frames * FRAME_CYCLES;
+}
+
+int vipTiming::cost(uint16_t instr, uint16_t oldPC) {
+    bool skipped = processor->programCounter == (uint16_t)(oldPC + 4);
+    const uint8_t *memory = processor->memory;
+    uint16_t index = processor->indexRegister;
+
+    switch(I(instr)) {
+        case 0x0:
+            return NNN(instr) == 0x0E0 ? 770 : 10;      // 00E0, 00EE
+        case 0x1:
+            return 12;                                  // 1NNN
+        case 0x2:
+            return 26;                                  // 2NNN
+        case 0x3:
+        case 0x4:
+            return 10 + skipped * SKIP_COST;            // 3XNN, 4XNN
+        case 0x5:
+        case 0x9:
+            return 14 + skipped * SKIP_COST;            // 5XY0, 9XY0
+        case 0x6:
+            return 6;                                   // 6XNN
+        case 0x7:
+            return 10;                                  // 7XNN
+        case 0x8:
+            return 44;                                  // 8XYN
+        case 0xA:
+            return 12;                                  // ANNN
+        case 0xB:
+            return 22;                                  // BNNN
+        case 0xC:
+            return 36;                                  // CXNN
+        case 0xD:
+            return 68 + 46 * N(instr);                  // DXYN
+        case 0xE:
+            return 14 + skipped * SKIP_COST;            // EX9E, EXA1
+        default:
+            break;
+    }
+
+    switch(NN(instr)) {
+        case 0x0A:
+            return 19;                                  // FX0A, per poll
+        case 0x1E:
+        case 0x29:
+            return 16;                                  // FX1E, FX29
+        case 0x33:                                      // FX33
+            return 80 + 16 * (memory[index % MEM_SIZE] 
+                                + memory[(index + 1) % MEM_SIZE] 
+                                + memory[(index + 2) % MEM_SIZE]);
+        case 0x55:
+        case 0x65:
+            return 14 + 14 * (X(instr) + 1);            // FX55, FX65
+        default:
+            return 10;                                  // FX07, FX15, FX18
+    }
+}
+
+bool vipTiming::runFrame() {
+
+    // execute one 60 Hz frame worth of instructions; an instruction that 
+    // overruns the budget is paid for out of the next frame
+
+    bool refreshDisplay = false;
+    credit += FRAME_BUDGET;
+    frames++;
+
+    while(credit > 0) {
+        uint16_t oldPC = processor->programCounter;
+        uint16_t instr = processor->fetch();
+        refreshDisplay |= processor->decode(instr);
+
+        int charge = FETCH_COST + cost(instr, oldPC);
+        credit -= charge;
+        instructions++;
+
+        if(I(instr) == 0xD) {
+            if(credit > 0)
+                credit = 0;
+            break;
+        }
+    }
+
+    return refreshDisplay;
+}
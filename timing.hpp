@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include "chip8.hpp"
+
+class vipTiming {
+
+    Chip8 *processor;
+    long credit;                            // machine cycles left in this 
+                                            // frame, negative if overspent
+    uint64_t frames;                        // frames run so far
+    uint64_t instructions;                  // total executed so far
+
+    int cost(uint16_t, uint16_t);
+
+public:
+
+    vipTiming(Chip8*);
+    bool runFrame();
+    uint64_t cycles() const;
+    uint64_t executed() const { return instructions; }
+
+};
@@ -0,0 +1,168 @@
+#include "video.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************
+/
+/  Frame capture
+/
+/  pushFrame() is called once per 60 Hz tick by the front-end. Frames are
+/  packed and handed to a background encoder thread through a bounded queue;
+/  the caller only blocks if the encoder falls QUEUE_SIZE frames behind.
+/
+/  A path ending in .y4m (or - for stdout) gets a raw 64x32 greyscale Y4M
+/  stream at 60 fps, which e.g. ffmpeg can scale and encode. Anything else is
+/  used as a prefix for a PNG sequence, <prefix>NNNNNN.png, numbered by frame.
+/
+/  Identical consecutive frames are deduplicated: the Y4M encoder rewrites
+/  the previous picture without converting it again, and the PNG sequence
+/  skips the file, so a gap in the numbering means the image was held.
+/
+******************************************************************************/
+
+#define QUEUE_SIZE 64
+
+videoSink::videoSink(const char *path) {
+    size_t length = strlen(path);
+    y4m = strcmp(path, "-") == 0 
+            || (length >= 4 && strcmp(path + length - 4, ".y4m") == 0);
+    stream = NULL;
+    prefix = path;
+
+    if(y4m) {
+        stream = strcmp(path, "-") == 0 ? stdout : fopen(path, "wb");
+        if(stream == NULL) {
+            fprintf(stderr, "Unable to open video output: %s\n", path);
+            exit(42);
+        }
+        fprintf(stream, "YUV4MPEG2 W64 H32 F60:1 Ip A1:1 Cmono\n");
+    }
+
+    closing = false;
+    frameNumber = 0;
+    encoder = std::thread(&videoSink::encode, this);
+}
+
+videoSink::~videoSink() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+    }
+    notEmpty.notify_one();
+    encoder.join();
+
+    if(stream != NULL && stream != stdout)
+        fclose(stream);
+    else if(stream != NULL)
+        fflush(stream);
+}
+
+void videoSink::pushFrame(const Chip8 &processor) {
+    frame next;
+    processor.packDisplay(next.packed);
+    next.number = frameNumber++;
+    next.repeat = next.number > 0 && memcmp(next.packed, last, 256) == 0;
+    memcpy(last, next.packed, 256);
+
+    // a held image needs no PNG at all
+
+    if(next.repeat && !y4m)
+        return;
+
+    std::unique_lock<std::mutex> guard(lock);
+    notFull.wait(guard, [this] { return queue.size() < QUEUE_SIZE; });
+    queue.push_back(next);
+    guard.unlock();
+    notEmpty.notify_one();
+}
+
+void videoSink::encode() {
+    while(true) {
+        std::unique_lock<std::mutex> guard(lock);
+        notEmpty.wait(guard, [this] { return closing || !queue.empty(); });
+        if(queue.empty())
+            return;
+        frame next = queue.front();
+        queue.pop_front();
+        guard.unlock();
+        notFull.notify_one();
+
+        if(y4m)
+            writeY4M(next);
+        else
+            writePNG(next);
+    }
+}
+
+void videoSink::writeY4M(const frame &next) {
+    if(!next.repeat) {
+        for(int i = 0; i < 32 * 64; ++i)
+            luma[i] = (next.packed[i / 8] & (0x80 >> (i % 8))) ? 0xFF : 0x00;
+    }
+
+    fputs("FRAME\n", stream);
+    fwrite(luma, 1, sizeof(luma), stream);
+}
+
+static uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0) {
+    crc = ~crc;
+    for(size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for(int bit = 0; bit < 8; ++bit)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void put32(uint8_t *p, uint32_t value) {
+    p[0] = value >> 24, p[1] = value >> 16, p[2] = value >> 8, p[3] = value;
+}
+
+static void writeChunk(FILE *file, const char *type, const uint8_t *data, uint32_t length) {
+    uint8_t header[8], footer[4];
+    put32(header, length);
+    memcpy(header + 4, type, 4);
+    put32(footer, crc32(data, length, crc32(header + 4, 4)));
+    fwrite(header, 1, 8, file);
+    fwrite(data, 1, length, file);
+    fwrite(footer, 1, 4, file);
+}
+
+void videoSink::writePNG(const frame &next) {
+
+    // 64x32 1-bit greyscale: each scanline is a filter byte followed by the
+    // packed row as is, wrapped in a single stored (uncompressed) deflate 
+    // block, which keeps this free of a zlib dependency
+
+    const uint16_t rawSize = 32 * (1 + 8);
+    uint8_t ihdr[13] = { 0, 0, 0, 64, 0, 0, 0, 32, 1, 0, 0, 0, 0 };
+    uint8_t idat[2 + 5 + rawSize + 4] = { 0x78, 0x01, 0x01, 
+        rawSize & 0xFF, rawSize >> 8, (uint8_t)~rawSize, (uint8_t)(~rawSize >> 8) };
+
+    uint8_t *raw = idat + 7;
+    for(int row = 0; row < 32; ++row) {
+        raw[row * 9] = 0;
+        memcpy(raw + row * 9 + 1, next.packed + row * 8, 8);
+    }
+
+    uint32_t a = 1, b = 0;
+    for(int i = 0; i < rawSize; ++i)
+        a = (a + raw[i]) % 65521, b = (b + a) % 65521;
+    put32(raw + rawSize, (b << 16) | a);
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s%06llu.png", prefix.c_str(), 
+                (unsigned long long)next.number);
+    FILE *file = fopen(path, "wb");
+    if(file == NULL) {
+        fprintf(stderr, "Unable to write frame: %s\n", path);
+        return;
+    }
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    fwrite(signature, 1, 8, file);
+    writeChunk(file, "IHDR", ihdr, sizeof(ihdr));
+    writeChunk(file, "IDAT", idat, sizeof(idat));
+    writeChunk(file, "IEND", NULL, 0);
+    fclose(file);
+}
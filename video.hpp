@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "chip8.hpp"
+
+class videoSink {
+
+    struct frame {
+        uint8_t packed[256];                // see Chip8::packDisplay
+        uint64_t number;
+        bool repeat;                        // same image as previous frame
+    };
+
+    bool y4m;                               // Y4M stream, else PNG sequence
+    FILE *stream;
+    std::string prefix;
+
+    std::deque<frame> queue;                // bounded, see QUEUE_SIZE
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    bool closing;
+    std::thread encoder;
+
+    uint8_t luma[32 * 64];                  // last Y4M picture written
+    uint8_t last[256];
+    uint64_t frameNumber;
+
+    void encode();
+    void writeY4M(const frame&);
+    void writePNG(const frame&);
+
+public:
+
+    videoSink(const char*);
+    ~videoSink();
+    void pushFrame(const Chip8&);
+
+};